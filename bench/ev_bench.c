@@ -0,0 +1,795 @@
+/*
+ * libev benchmark suite
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modifica-
+ * tion, are permitted provided that the following conditions are met:
+ *
+ *   1.  Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *   2.  Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MER-
+ * CHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPE-
+ * CIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTH-
+ * ERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * the GNU General Public License ("GPL") version 2 or any later version,
+ * in which case the provisions of the GPL are applicable instead of
+ * the above. If you wish to allow the use of your version of this file
+ * only under the terms of the GPL and not to allow others to use your
+ * version of this file under the BSD license, indicate your decision
+ * by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL. If you do not delete the
+ * provisions above, a recipient may use your version of this file under
+ * either the BSD or the GPL.
+ */
+
+/*
+ * reproducible microbenchmarks for the backends and watcher types.
+ *
+ * usage: ev_bench [-q] [-l] [benchmark...]
+ *
+ *   -q  quick: ten times fewer iterations, for smoke tests
+ *   -l  large: also run the timer benchmarks with 10 million timers
+ *
+ * without benchmark names, all benchmarks are run. every result is
+ * printed as a single line of json, so the output can be diffed or fed
+ * to a regression checker directly, for example:
+ *
+ *   {"bench":"pingpong","backend":"epoll","fds":"pipe","n":200000,"ns_per_op":2876.4}
+ *
+ * "ns_per_op" is the wall-clock time per operation (a round trip, a
+ * timer operation and so on) in nanoseconds, lower is better. benchmarks
+ * that cannot run on this system (such as an unsupported backend) print
+ * a result with "skipped" instead.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "event.h"
+
+static int quick;
+static int large;
+
+/*****************************************************************************/
+
+static double
+now (void)
+{
+  struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC
+  if (!clock_gettime (CLOCK_MONOTONIC, &ts))
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+#endif
+
+  return EV_TS_TO_SEC (ev_time ());
+}
+
+/* xorshift, so every run does the same operations */
+static unsigned int rng_state;
+
+static void
+rng_seed (void)
+{
+  rng_state = 2463534242U;
+}
+
+static unsigned int
+rng (void)
+{
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+
+  return rng_state;
+}
+
+static long
+iterations (long n)
+{
+  return quick ? n / 10 : n;
+}
+
+/* params is a (possibly empty) list of "key":"value", pairs */
+static void
+result (const char *bench, const char *params, long n, double elapsed)
+{
+  printf ("{\"bench\":\"%s\",%s\"n\":%ld,\"ns_per_op\":%.1f}\n", bench, params, n, elapsed * 1e9 / n);
+  fflush (stdout);
+}
+
+static void
+skipped (const char *bench, const char *params, const char *why)
+{
+  printf ("{\"bench\":\"%s\",%s\"skipped\":\"%s\"}\n", bench, params, why);
+  fflush (stdout);
+}
+
+static const struct
+{
+  const char *name;
+  unsigned int flag;
+} backends [] = {
+  { "select"  , EVBACKEND_SELECT   },
+  { "poll"    , EVBACKEND_POLL     },
+  { "epoll"   , EVBACKEND_EPOLL    },
+  { "linuxaio", EVBACKEND_LINUXAIO },
+  { "iouring" , EVBACKEND_IOURING  },
+  { "kqueue"  , EVBACKEND_KQUEUE   },
+  { "port"    , EVBACKEND_PORT     },
+};
+
+static int
+make_pair (const char *kind, int fds [2])
+{
+  if (!strcmp (kind, "pipe") ? pipe (fds) : socketpair (AF_UNIX, SOCK_STREAM, 0, fds))
+    return -1;
+
+  fcntl (fds [0], F_SETFL, O_NONBLOCK);
+  fcntl (fds [1], F_SETFL, O_NONBLOCK);
+
+  return 0;
+}
+
+/*****************************************************************************/
+
+/* one byte bounces between two fd pairs, both ends watched by the same loop */
+
+static struct pingpong
+{
+  ev_io r [2];
+  int fds [2][2];
+  long count, n;
+} pp;
+
+static void
+pingpong_cb (EV_P_ ev_io *w, int revents)
+{
+  int side = w == &pp.r [1];
+  char c;
+
+  if (read (pp.fds [side][0], &c, 1) != 1)
+    return;
+
+  if (++pp.count >= pp.n)
+    {
+      ev_io_stop (EV_A_ &pp.r [0]);
+      ev_io_stop (EV_A_ &pp.r [1]);
+      return;
+    }
+
+  write (pp.fds [!side][1], &c, 1);
+}
+
+static int
+pingpong_setup (const char *kind, long n)
+{
+  if (make_pair (kind, pp.fds [0]))
+    return -1;
+
+  if (make_pair (kind, pp.fds [1]))
+    {
+      close (pp.fds [0][0]);
+      close (pp.fds [0][1]);
+      return -1;
+    }
+
+  pp.count = 0;
+  pp.n     = n;
+
+  return 0;
+}
+
+static void
+pingpong_teardown (void)
+{
+  close (pp.fds [0][0]); close (pp.fds [0][1]);
+  close (pp.fds [1][0]); close (pp.fds [1][1]);
+}
+
+/* returns the elapsed time, or a negative value on failure */
+static double
+pingpong_run (struct ev_loop *loop, const char *kind, long n)
+{
+  double start;
+
+  if (pingpong_setup (kind, n))
+    return -1.;
+
+  ev_io_init (&pp.r [0], pingpong_cb, pp.fds [0][0], EV_READ);
+  ev_io_init (&pp.r [1], pingpong_cb, pp.fds [1][0], EV_READ);
+  ev_io_start (loop, &pp.r [0]);
+  ev_io_start (loop, &pp.r [1]);
+
+  start = now ();
+  write (pp.fds [0][1], "x", 1);
+  ev_run (loop, 0);
+  start = now () - start;
+
+  pingpong_teardown ();
+
+  return start;
+}
+
+static void
+bench_pingpong (void)
+{
+  static const char *kinds [] = { "pipe", "socketpair" };
+  long n = iterations (200000);
+  unsigned int b, k;
+
+  for (b = 0; b < sizeof (backends) / sizeof (backends [0]); ++b)
+    for (k = 0; k < 2; ++k)
+      {
+        char params [128];
+        struct ev_loop *loop;
+        double elapsed;
+
+        snprintf (params, sizeof (params), "\"backend\":\"%s\",\"fds\":\"%s\",", backends [b].name, kinds [k]);
+
+        if (!(ev_supported_backends () & backends [b].flag)
+            || !(loop = ev_loop_new (backends [b].flag | EVFLAG_NOENV)))
+          {
+            skipped ("pingpong", params, "backend not supported");
+            continue;
+          }
+
+        if ((elapsed = pingpong_run (loop, kinds [k], n)) < 0.)
+          skipped ("pingpong", params, "cannot create fds");
+        else if (pp.count < n)
+          skipped ("pingpong", params, "backend cannot watch these fds");
+        else
+          result ("pingpong", params, n, elapsed);
+
+        ev_loop_destroy (loop);
+      }
+}
+
+/*****************************************************************************/
+
+/* the same ping-pong through the libevent compatibility layer */
+
+static struct event compat_ev [2];
+
+static void
+compat_cb (int fd, short events, void *arg)
+{
+  int side = arg != 0;
+  char c;
+
+  if (read (pp.fds [side][0], &c, 1) != 1)
+    return;
+
+  if (++pp.count >= pp.n)
+    {
+      event_del (&compat_ev [0]);
+      event_del (&compat_ev [1]);
+      return;
+    }
+
+  write (pp.fds [!side][1], &c, 1);
+}
+
+static void
+bench_compat (void)
+{
+  long n = iterations (200000);
+  struct event_base *base;
+  struct ev_loop *loop;
+  double elapsed;
+  int side;
+
+  /* the baseline, raw ev_io watchers with the default backend */
+  loop = ev_loop_new (EVFLAG_AUTO);
+  elapsed = pingpong_run (loop, "socketpair", n);
+  ev_loop_destroy (loop);
+
+  if (elapsed < 0.)
+    {
+      skipped ("compat", "", "cannot create fds");
+      return;
+    }
+
+  result ("compat", "\"api\":\"ev\",", n, elapsed);
+
+  if (pingpong_setup ("socketpair", n))
+    return;
+
+  base = event_base_new ();
+
+  for (side = 0; side < 2; ++side)
+    {
+      event_set (&compat_ev [side], pp.fds [side][0], EV_READ | EV_PERSIST, compat_cb, side ? (void *)1 : 0);
+      event_base_set (base, &compat_ev [side]);
+      event_add (&compat_ev [side], 0);
+    }
+
+  elapsed = now ();
+  write (pp.fds [0][1], "x", 1);
+  event_base_dispatch (base);
+  elapsed = now () - elapsed;
+
+  result ("compat", "\"api\":\"event\",", n, elapsed);
+
+  event_base_free (base);
+  pingpong_teardown ();
+}
+
+/*****************************************************************************/
+
+/* start, then randomly restart, again and stop, then stop all timers, */
+/* then start them all again in bulk */
+
+static void
+timer_cb (EV_P_ ev_timer *w, int revents)
+{
+}
+
+static void
+bench_timers_with (unsigned int flags, const char *mode, long count)
+{
+  long ops = iterations (count < 1000000 ? 1000000 : count);
+  char params [128];
+  struct ev_loop *loop = ev_loop_new (flags);
+  ev_timer *timers = (ev_timer *)malloc (sizeof (ev_timer) * count);
+  ev_timer **list = (ev_timer **)malloc (sizeof (ev_timer *) * count);
+  double start;
+  long i;
+
+  snprintf (params, sizeof (params), "\"mode\":\"%s\",\"timers\":%ld,", mode, count);
+
+  if (!loop || !timers)
+    {
+      skipped ("timers_start", params, loop ? "out of memory" : "cannot create loop");
+      free (timers);
+      free (list);
+      if (loop)
+        ev_loop_destroy (loop);
+      return;
+    }
+
+  rng_seed ();
+
+  /* far in the future, so that none expires while we measure */
+  start = now ();
+  for (i = 0; i < count; ++i)
+    {
+      ev_timer_init (timers + i, timer_cb, EV_TS_FROM_SEC (1000. + (rng () % 100000) * 1e-3), EV_TS_FROM_SEC (1.));
+      ev_timer_start (loop, timers + i);
+    }
+  result ("timers_start", params, count, now () - start);
+
+  start = now ();
+  for (i = 0; i < ops; ++i)
+    {
+      ev_timer *w = timers + rng () % count;
+
+      switch (rng () % 3)
+        {
+          case 0:
+            ev_timer_stop (loop, w);
+            ev_timer_set (w, EV_TS_FROM_SEC (1000. + (rng () % 100000) * 1e-3), EV_TS_FROM_SEC (1.));
+            ev_timer_start (loop, w);
+            break;
+
+          case 1:
+            w->repeat = EV_TS_FROM_SEC (1000. + (rng () % 100000) * 1e-3);
+            ev_timer_again (loop, w);
+            break;
+
+          case 2:
+            if (ev_is_active (w))
+              ev_timer_stop (loop, w);
+            else
+              ev_timer_start (loop, w);
+            break;
+        }
+    }
+  result ("timers_churn", params, ops, now () - start);
+
+  start = now ();
+  for (i = 0; i < count; ++i)
+    ev_timer_stop (loop, timers + i);
+  result ("timers_stop", params, count, now () - start);
+
+  /* the same random timers as timers_start, but started with one heap rebuild */
+  if (list)
+    {
+      rng_seed ();
+
+      start = now ();
+      for (i = 0; i < count; ++i)
+        {
+          ev_timer_set (timers + i, EV_TS_FROM_SEC (1000. + (rng () % 100000) * 1e-3), EV_TS_FROM_SEC (1.));
+          list [i] = timers + i;
+        }
+      ev_timer_start_many (loop, list, count);
+      result ("timers_start_many", params, count, now () - start);
+
+      for (i = 0; i < count; ++i)
+        ev_timer_stop (loop, timers + i);
+    }
+
+  ev_loop_destroy (loop);
+  free (timers);
+  free (list);
+}
+
+static void
+bench_timers (void)
+{
+  long count;
+
+  for (count = 1000; count <= (large ? 10000000 : 1000000); count *= 10)
+    {
+      bench_timers_with (EVFLAG_AUTO | EVFLAG_NOENV, "heap", count);
+      bench_timers_with (EVFLAG_AUTO | EVFLAG_NOENV | EVFLAG_TIMERWHEEL, "wheel", count);
+    }
+}
+
+/*****************************************************************************/
+
+/* the cost of the time base: updating the loop time with each clock source, */
+/* and expiring timers, which is mostly comparing and moving heap keys. run */
+/* this against a libev built with and without EV_TSTAMP_INT64 to compare */
+/* both representations */
+
+static long expire_count;
+
+static void
+expire_cb (EV_P_ ev_timer *w, int revents)
+{
+  ++expire_count;
+}
+
+static const struct
+{
+  const char *name;
+  unsigned int flag;
+} clocks [] = {
+  { "monotonic", 0                  },
+  { "coarse"   , EVFLAG_COARSECLOCK },
+  { "tsc"      , EVFLAG_TSCCLOCK    },
+};
+
+static void
+bench_time (void)
+{
+  enum { TIMERS = 100000 };
+  struct ev_loop *loop;
+  ev_timer *timers = (ev_timer *)malloc (sizeof (ev_timer) * TIMERS);
+  long i, n;
+  double start;
+  int c;
+
+  for (c = 0; c < sizeof (clocks) / sizeof (clocks [0]); ++c)
+    {
+      char params [64];
+
+      snprintf (params, sizeof (params), "\"clock\":\"%s\",", clocks [c].name);
+      loop = ev_loop_new (EVFLAG_AUTO | EVFLAG_NOENV | clocks [c].flag);
+      n = iterations (10000000);
+
+      /* the tsc is only used once it has been calibrated, on the first resync */
+      ev_sleep (EV_TS_FROM_SEC (.6));
+      ev_now_update (loop);
+
+      start = now ();
+      for (i = 0; i < n; ++i)
+        ev_now_update (loop);
+      result ("time_update", params, n, now () - start);
+
+      ev_loop_destroy (loop);
+    }
+
+  loop = ev_loop_new (EVFLAG_AUTO | EVFLAG_NOENV);
+
+  if (!timers)
+    {
+      skipped ("timers_expire", "", "out of memory");
+      ev_loop_destroy (loop);
+      return;
+    }
+
+  rng_seed ();
+  expire_count = 0;
+  n = iterations (TIMERS * 10);
+
+  start = now ();
+  for (i = 0; i < n / TIMERS; ++i)
+    {
+      long j;
+
+      /* all in the past, in random order, so one iteration expires them all */
+      for (j = 0; j < TIMERS; ++j)
+        {
+          ev_timer_init (timers + j, expire_cb, EV_TS_FROM_SEC (-1e-6 * (rng () % 1000000)), 0.);
+          ev_timer_start (loop, timers + j);
+        }
+
+      ev_run (loop, EVRUN_NOWAIT);
+    }
+  result ("timers_expire", "", expire_count, now () - start);
+
+  ev_loop_destroy (loop);
+  free (timers);
+}
+
+/*****************************************************************************/
+
+/* two loops in two threads wake each other up via ev_async */
+
+static struct
+{
+  struct ev_loop *loop [2];
+  ev_async w [2];
+  long count, n;
+} ap;
+
+static void
+async_cb (EV_P_ ev_async *w, int revents)
+{
+  int side = w == &ap.w [1];
+
+  /* only side 0 counts, so it knows when to stop both */
+  if (!side && ++ap.count >= ap.n)
+    {
+      ev_async_stop (EV_A_ w);
+      ev_async_send (ap.loop [1], &ap.w [1]);
+      return;
+    }
+
+  if (side && ap.count >= ap.n)
+    {
+      ev_async_stop (EV_A_ w);
+      return;
+    }
+
+  ev_async_send (ap.loop [!side], &ap.w [!side]);
+}
+
+static void *
+async_thread (void *arg)
+{
+  ev_run (ap.loop [1], 0);
+
+  return 0;
+}
+
+static void
+bench_async (void)
+{
+  pthread_t thread;
+  double start;
+  int side;
+
+  ap.count = 0;
+  ap.n     = iterations (200000);
+
+  for (side = 0; side < 2; ++side)
+    {
+      ap.loop [side] = ev_loop_new (EVFLAG_AUTO | EVFLAG_NOENV);
+      ev_async_init (&ap.w [side], async_cb);
+      ev_async_start (ap.loop [side], &ap.w [side]);
+    }
+
+  if (pthread_create (&thread, 0, async_thread, 0))
+    {
+      skipped ("async_pingpong", "", "cannot create thread");
+      return;
+    }
+
+  start = now ();
+  ev_async_send (ap.loop [1], &ap.w [1]);
+  ev_run (ap.loop [0], 0);
+  pthread_join (thread, 0);
+  result ("async_pingpong", "", ap.n, now () - start);
+
+  for (side = 0; side < 2; ++side)
+    ev_loop_destroy (ap.loop [side]);
+}
+
+/*****************************************************************************/
+
+/* each signal handler raises the next signal */
+
+static long sig_count, sig_n;
+
+static void
+signal_cb (EV_P_ ev_signal *w, int revents)
+{
+  if (++sig_count >= sig_n)
+    ev_signal_stop (EV_A_ w);
+  else
+    raise (SIGUSR1);
+}
+
+static void
+bench_signal (void)
+{
+  struct ev_loop *loop = ev_default_loop (EVFLAG_AUTO | EVFLAG_NOENV);
+  ev_signal w;
+  double start;
+
+  sig_count = 0;
+  sig_n     = iterations (100000);
+
+  ev_signal_init (&w, signal_cb, SIGUSR1);
+  ev_signal_start (loop, &w);
+
+  start = now ();
+  raise (SIGUSR1);
+  ev_run (loop, 0);
+  result ("signal", "", sig_n, now () - start);
+}
+
+/*****************************************************************************/
+
+/* each ev_once callback schedules the next one */
+
+static struct ev_loop *once_loop;
+static long once_count, once_n;
+
+static void
+once_cb (int revents, void *arg)
+{
+  if (++once_count < once_n)
+    ev_once (once_loop, -1, 0, 0., once_cb, 0);
+}
+
+static void
+bench_once (void)
+{
+  double start;
+
+  once_loop  = ev_loop_new (EVFLAG_AUTO | EVFLAG_NOENV);
+  once_count = 0;
+  once_n     = iterations (1000000);
+
+  start = now ();
+  ev_once (once_loop, -1, 0, 0., once_cb, 0);
+  ev_run (once_loop, 0);
+  result ("once", "", once_n, now () - start);
+
+  ev_loop_destroy (once_loop);
+}
+
+/*****************************************************************************/
+
+/* start and stop stat watchers on a number of files */
+
+static void
+stat_cb (EV_P_ ev_stat *w, int revents)
+{
+}
+
+static void
+bench_stat (void)
+{
+  enum { FILES = 64 };
+  struct ev_loop *loop = ev_loop_new (EVFLAG_AUTO | EVFLAG_NOENV);
+  static char paths [FILES][64];
+  static ev_stat w [FILES];
+  long i, n = iterations (100000);
+  double start;
+
+  for (i = 0; i < FILES; ++i)
+    {
+      int fd;
+
+      snprintf (paths [i], sizeof (paths [i]), "/tmp/ev_bench.%d.%ld", (int)getpid (), i);
+
+      if ((fd = open (paths [i], O_CREAT | O_WRONLY, 0600)) < 0)
+        {
+          skipped ("stat_churn", "", "cannot create files");
+          n = 0;
+          break;
+        }
+
+      close (fd);
+      ev_stat_init (w + i, stat_cb, paths [i], 0.);
+    }
+
+  if (n)
+    {
+      start = now ();
+      for (i = 0; i < n; ++i)
+        {
+          ev_stat_start (loop, w + i % FILES);
+
+          if (i >= FILES / 2)
+            ev_stat_stop (loop, w + (i - FILES / 2) % FILES);
+        }
+      result ("stat_churn", "", n, now () - start);
+    }
+
+  for (i = 0; i < FILES; ++i)
+    {
+      ev_stat_stop (loop, w + i);
+      unlink (paths [i]);
+    }
+
+  ev_loop_destroy (loop);
+}
+
+/*****************************************************************************/
+
+static const struct
+{
+  const char *name;
+  void (*run)(void);
+} benchmarks [] = {
+  { "pingpong", bench_pingpong },
+  { "compat"  , bench_compat   },
+  { "timers"  , bench_timers   },
+  { "time"    , bench_time     },
+  { "async"   , bench_async    },
+  { "signal"  , bench_signal   },
+  { "once"    , bench_once     },
+  { "stat"    , bench_stat     },
+};
+
+int
+main (int argc, char *argv [])
+{
+  int i, j, names = 0;
+
+  for (i = 1; i < argc; ++i)
+    if (!strcmp (argv [i], "-q"))
+      quick = 1;
+    else if (!strcmp (argv [i], "-l"))
+      large = 1;
+    else if (argv [i][0] == '-')
+      {
+        fprintf (stderr, "usage: %s [-q] [-l] [benchmark...]\n", argv [0]);
+        return 1;
+      }
+    else
+      ++names;
+
+  signal (SIGPIPE, SIG_IGN);
+
+  printf ("{\"libev\":\"%d.%d\",\"supported_backends\":%u,\"recommended_backends\":%u,\"tstamp\":\"%s\",\"quick\":%d}\n",
+          ev_version_major (), ev_version_minor (),
+          ev_supported_backends (), ev_recommended_backends (),
+          EV_TSTAMP_INT64 ? "int64" : "double", quick);
+
+  for (j = 0; j < sizeof (benchmarks) / sizeof (benchmarks [0]); ++j)
+    {
+      int run = !names;
+
+      for (i = 1; i < argc; ++i)
+        if (!strcmp (argv [i], benchmarks [j].name))
+          run = 1;
+
+      if (run)
+        benchmarks [j].run ();
+    }
+
+  return 0;
+}
+
@@ -63,6 +63,8 @@ namespace ev {
     NONE     = EV_NONE,
     READ     = EV_READ,
     WRITE    = EV_WRITE,
+    EDGE     = EV_EDGE,
+    EXCLUSIVE = EV_EXCLUSIVE,
 #if EV_COMPAT3
     TIMEOUT  = EV_TIMEOUT,
 #endif
@@ -77,6 +79,9 @@ namespace ev {
     FORK     = EV_FORK,
     ASYNC    = EV_ASYNC,
     EMBED    = EV_EMBED,
+    URING    = EV_URING,
+    CHANNEL  = EV_CHANNEL,
+    WORK     = EV_WORK,
 #   undef ERROR // some systems stupidly #define ERROR
     ERROR    = EV_ERROR
   };
@@ -261,6 +266,33 @@ namespace ev {
     {
       ev_set_timeout_collect_interval (EV_AX_ interval);
     }
+
+    void set_busypoll_interval (tstamp interval) EV_NOEXCEPT
+    {
+      ev_set_busypoll_interval (EV_AX_ interval);
+    }
+
+    unsigned int busypoll_spins () const EV_NOEXCEPT
+    {
+      return ev_busypoll_spins (EV_AX);
+    }
+
+    unsigned int busypoll_hits () const EV_NOEXCEPT
+    {
+      return ev_busypoll_hits (EV_AX);
+    }
+#endif
+
+#if EV_STATS_ENABLE
+    void set_stats (bool enable = true) EV_NOEXCEPT
+    {
+      ev_set_stats (EV_AX_ enable);
+    }
+
+    bool stats (ev_stats &stats) const EV_NOEXCEPT
+    {
+      return ev_loop_stats (EV_AX_ &stats);
+    }
 #endif
 
     // function callback
@@ -342,6 +374,18 @@ namespace ev {
       ev_feed_signal_event (EV_AX_ signum);
     }
 
+#if EV_URING_ENABLE
+    void uring_buffers (unsigned int count, unsigned int size) EV_NOEXCEPT
+    {
+      ev_uring_buffers (EV_AX_ count, size);
+    }
+
+    void uring_release (void *buf) EV_NOEXCEPT
+    {
+      ev_uring_release (EV_AX_ buf);
+    }
+#endif
+
 #if EV_MULTIPLICITY
     struct ev_loop* EV_AX;
 #endif
@@ -580,6 +624,33 @@ namespace ev {
     ev_set_syserr_cb (cb);
   }
 
+  // collects the watchers in [first, last), which must all use the same loop,
+  // and starts them with a single call to the bulk start function
+  template<class cstem, class Iterator>
+  inline void start_many_ (Iterator first, Iterator last, void (*start)(EV_P_ cstem **w, int count) EV_NOEXCEPT)
+  {
+    int count = 0;
+
+    for (Iterator i = first; i != last; ++i)
+      ++count;
+
+    if (!count)
+      return;
+
+    cstem **w = new cstem *[count];
+
+    count = 0;
+    for (Iterator i = first; i != last; ++i)
+      w [count++] = static_cast<cstem *>(&*i);
+
+  #if EV_MULTIPLICITY
+    EV_P = (*first).EV_A;
+  #endif
+    start (EV_A_ w, count);
+
+    delete [] w;
+  }
+
   #if EV_MULTIPLICITY
     #define EV_CONSTRUCT(cppstem,cstem)	                                                \
       (EV_PX = get_default_loop ()) EV_NOEXCEPT                                         \
@@ -656,6 +727,12 @@ namespace ev {
       ev_timer_set (static_cast<ev_timer *>(this), after, repeat);
     }
 
+    void set_slack (ev_tstamp slack) EV_NOEXCEPT
+    {
+      freeze_guard freeze (this);
+      ev_timer_set_slack (static_cast<ev_timer *>(this), slack);
+    }
+
     void start (ev_tstamp after, ev_tstamp repeat = 0.) EV_NOEXCEPT
     {
       set (after, repeat);
@@ -671,6 +748,12 @@ namespace ev {
     {
       return ev_timer_remaining (EV_A_ static_cast<ev_timer *>(this));
     }
+
+    template<class Iterator>
+    static void start_many (Iterator first, Iterator last)
+    {
+      start_many_<ev_timer> (first, last, ev_timer_start_many);
+    }
   EV_END_WATCHER (timer, timer)
 
   #if EV_PERIODIC_ENABLE
@@ -691,6 +774,12 @@ namespace ev {
     {
       ev_periodic_again (EV_A_ static_cast<ev_periodic *>(this));
     }
+
+    template<class Iterator>
+    static void start_many (Iterator first, Iterator last)
+    {
+      start_many_<ev_periodic> (first, last, ev_periodic_start_many);
+    }
   EV_END_WATCHER (periodic, periodic)
   #endif
 
@@ -807,6 +896,70 @@ namespace ev {
   EV_END_WATCHER (async, async)
   #endif
 
+  #if EV_CHANNEL_ENABLE
+  EV_BEGIN_WATCHER (channel, channel)
+    void set (unsigned int limit = 0) EV_NOEXCEPT
+    {
+      freeze_guard freeze (this);
+      ev_channel_set (static_cast<ev_channel *>(this), limit);
+    }
+
+    bool send (ev_channel_msg *msg) EV_NOEXCEPT
+    {
+      return ev_channel_send (EV_A_ static_cast<ev_channel *>(this), msg);
+    }
+
+    ev_channel_msg *recv () EV_NOEXCEPT
+    {
+      return ev_channel_recv (EV_A_ static_cast<ev_channel *>(this));
+    }
+  EV_END_WATCHER (channel, channel)
+  #endif
+
+  #if EV_WORK_ENABLE
+  EV_BEGIN_WATCHER (work, work)
+    void set (void (*work)(ev_work *w)) EV_NOEXCEPT
+    {
+      freeze_guard freeze (this);
+      ev_work_set (static_cast<ev_work *>(this), work);
+    }
+
+    void start (void (*work)(ev_work *w)) EV_NOEXCEPT
+    {
+      stop ();
+      set (work);
+      start ();
+    }
+  EV_END_WATCHER (work, work)
+  #endif
+
+  #if EV_URING_ENABLE
+  EV_BEGIN_WATCHER (uring, uring)
+    void set (int op, int fd, void *buf, unsigned int len, long long off = -1, int flags = 0) EV_NOEXCEPT
+    {
+      freeze_guard freeze (this);
+      ev_uring_set (static_cast<ev_uring *>(this), op, fd, buf, len, off, flags);
+    }
+
+    void start (int op, int fd, void *buf, unsigned int len, long long off = -1, int flags = 0) EV_NOEXCEPT
+    {
+      stop ();
+      set (op, fd, buf, len, off, flags);
+      start ();
+    }
+
+    int result () const EV_NOEXCEPT
+    {
+      return res;
+    }
+
+    bool busy () const EV_NOEXCEPT
+    {
+      return ev_uring_busy (this);
+    }
+  EV_END_WATCHER (uring, uring)
+  #endif
+
   #undef EV_PX
   #undef EV_PX_
   #undef EV_CONSTRUCT
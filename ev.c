@@ -189,6 +189,11 @@
 #  define EV_USE_TIMERFD 0
 # endif
 
+# if !HAVE_SYS_SDT_H
+#  undef EV_USE_USDT
+#  define EV_USE_USDT 0
+# endif
+
 #endif
 
 /* OS X, in its infinite idiocy, actually HARDCODES
@@ -308,6 +313,26 @@
 # define EV_USE_REALTIME !EV_USE_CLOCK_SYSCALL
 #endif
 
+#if __linux && !defined CLOCK_MONOTONIC_COARSE
+# define CLOCK_MONOTONIC_COARSE 6 /* 2.6.32+, but hidden by strict standard modes */
+#endif
+
+#ifndef EV_USE_COARSECLOCK
+# ifdef CLOCK_MONOTONIC_COARSE
+#  define EV_USE_COARSECLOCK EV_FEATURE_OS
+# else
+#  define EV_USE_COARSECLOCK 0
+# endif
+#endif
+
+#ifndef EV_USE_TSC
+# if __GNUC__ && (__amd64 || __x86_64)
+#  define EV_USE_TSC EV_FEATURE_OS
+# else
+#  define EV_USE_TSC 0
+# endif
+#endif
+
 #ifndef EV_USE_NANOSLEEP
 # if _POSIX_C_SOURCE >= 199309L
 #  define EV_USE_NANOSLEEP EV_FEATURE_OS
@@ -328,6 +353,14 @@
 # endif
 #endif
 
+#ifndef EV_USE_PPOLL
+# if __linux
+#  define EV_USE_PPOLL EV_USE_POLL
+# else
+#  define EV_USE_PPOLL 0
+# endif
+#endif
+
 #ifndef EV_USE_EPOLL
 # if __linux && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 4))
 #  define EV_USE_EPOLL EV_FEATURE_BACKENDS
@@ -400,6 +433,10 @@
 # endif
 #endif
 
+#ifndef EV_USE_USDT
+# define EV_USE_USDT 0 /* always off by default */
+#endif
+
 #if 0 /* debugging */
 # define EV_VERIFY 3
 # define EV_USE_4HEAP 1
@@ -418,6 +455,26 @@
 # define EV_HEAP_CACHE_AT EV_FEATURE_DATA
 #endif
 
+#ifndef EV_FD_SPLIT
+# define EV_FD_SPLIT 0
+#endif
+
+#ifndef EV_FD_SPARSE
+# define EV_FD_SPARSE 0
+#endif
+
+#ifndef EV_FD_PAGE_BITS
+# define EV_FD_PAGE_BITS 8 /* 256 fds, one 4kb page with the default ANFD layout */
+#endif
+
+#ifndef EV_USE_TIMERWHEEL
+# define EV_USE_TIMERWHEEL EV_FEATURE_DATA
+#endif
+
+#ifndef EV_TIMERWHEEL_TICK
+# define EV_TIMERWHEEL_TICK 1e-3
+#endif
+
 #ifdef __ANDROID__
 /* supposedly, android doesn't typedef fd_mask */
 # undef EV_USE_SELECT
@@ -461,6 +518,22 @@
 # define EV_USE_REALTIME 0
 #endif
 
+/* the timer wheel relies on mn_now never going backwards */
+#if !EV_USE_MONOTONIC
+# undef EV_USE_TIMERWHEEL
+# define EV_USE_TIMERWHEEL 0
+#endif
+
+/* the cheaper clocks stand in for the monotonic clock, never for the realtime one */
+#if !EV_USE_MONOTONIC
+# undef EV_USE_COARSECLOCK
+# define EV_USE_COARSECLOCK 0
+# undef EV_USE_TSC
+# define EV_USE_TSC 0
+#endif
+
+#define EV_CLOCK_POLICY (EV_USE_COARSECLOCK || EV_USE_TSC)
+
 #if !EV_STAT_ENABLE
 # undef EV_USE_INOTIFY
 # define EV_USE_INOTIFY 0
@@ -481,6 +554,31 @@
 # endif
 #endif
 
+#if !EV_USE_POLL
+# undef EV_USE_PPOLL
+# define EV_USE_PPOLL 0
+#endif
+
+#if EV_USE_PPOLL
+# include <sys/syscall.h>
+# ifdef SYS_ppoll
+#  define EV_NEED_SYSCALL 1
+# else
+#  undef EV_USE_PPOLL
+#  define EV_USE_PPOLL 0
+# endif
+#endif
+
+#if EV_USE_EPOLL
+# include <sys/syscall.h>
+# if !SYS_epoll_pwait2 && __linux && !__alpha
+#  define SYS_epoll_pwait2 441
+# endif
+# ifdef SYS_epoll_pwait2
+#  define EV_NEED_SYSCALL 1
+# endif
+#endif
+
 #if EV_USE_LINUXAIO
 # include <sys/syscall.h>
 # if SYS_io_getevents && EV_USE_EPOLL /* linuxaio backend requires epoll backend */
@@ -516,6 +614,13 @@
 # endif
 #endif
 
+#if EV_URING_ENABLE
+# include <sys/socket.h>
+# ifndef MSG_DONTWAIT
+#  define MSG_DONTWAIT 0
+# endif
+#endif
+
 #if EV_USE_EVENTFD
 /* our minimum requirement is glibc 2.7 which has the stub, but not the full header */
 # include <stdint.h>
@@ -572,6 +677,30 @@ struct signalfd_siginfo
 # define EV_FREQUENT_CHECK do { } while (0)
 #endif
 
+/* static tracepoints for perf, bpftrace, systemtap and friends, */
+/* all probes are in the "libev" provider and get the loop as first argument */
+#if EV_USE_USDT
+# include <sys/sdt.h>
+# if EV_MULTIPLICITY
+#  define PROBE_LOOP (void *)loop
+# else
+#  define PROBE_LOOP (void *)0
+# endif
+# define PROBE(name)           DTRACE_PROBE1 (libev, name, PROBE_LOOP)
+# define PROBE1(name,a)        DTRACE_PROBE2 (libev, name, PROBE_LOOP, a)
+# define PROBE2(name,a,b)      DTRACE_PROBE3 (libev, name, PROBE_LOOP, a, b)
+# define PROBE3(name,a,b,c)    DTRACE_PROBE4 (libev, name, PROBE_LOOP, a, b, c)
+# define PROBE4(name,a,b,c,d)  DTRACE_PROBE5 (libev, name, PROBE_LOOP, a, b, c, d)
+/* probes cannot portably pass floating point values, so pass nanoseconds */
+# define PROBE_NSEC(t) (long long)EV_TS_TO_NSEC (t)
+#else
+# define PROBE(name)           do { } while (0)
+# define PROBE1(name,a)        do { } while (0)
+# define PROBE2(name,a,b)      do { } while (0)
+# define PROBE3(name,a,b,c)    do { } while (0)
+# define PROBE4(name,a,b,c,d)  do { } while (0)
+#endif
+
 /*
  * This is used to work around floating point rounding problems.
  * This value is good at least till the year 4000.
@@ -579,6 +708,9 @@ struct signalfd_siginfo
 #define MIN_INTERVAL  0.0001220703125 /* 1/2**13, good till 4000 */
 /*#define MIN_INTERVAL  0.00000095367431640625 /* 1/2**20, good till 2200 */
 
+#define MIN_SLACK     0.00000095367431640625 /* 1/2**20, timer slack below this is ignored */
+#define MAX_SLACK     1024.                  /* coarsest timer slack bucket */
+
 #define MIN_TIMEJUMP   1. /* minimum timejump that gets detected (if monotonic clock available) */
 #define MAX_BLOCKTIME  59.743 /* never wait longer than this time (to detect time jumps) */
 #define MAX_BLOCKTIME2 1500001.07 /* same, but when timerfd is used to detect jumps, also safe delay to not overflow */
@@ -586,12 +718,28 @@ struct signalfd_siginfo
 /* find a portable timestamp that is "always" in the future but fits into time_t.
  * this is quite hard, and we are mostly guessing - we handle 32 bit signed/unsigned time_t,
  * and sizes larger than 32 bit, and maybe the unlikely floating point time_t */
-#define EV_TSTAMP_HUGE \
+#if EV_TSTAMP_INT64
+/* for nanoseconds, we also need to leave enough room to add to it */
+# define EV_TSTAMP_HUGE 4000000000.
+#else
+# define EV_TSTAMP_HUGE \
   (sizeof (time_t) >= 8     ? 10000000000000.  \
    : 0 < (time_t)4294967295 ?     4294967295.  \
    :                              2147483647.) \
 
-#ifndef EV_TS_CONST
+#endif
+
+#if EV_TSTAMP_INT64
+# define EV_TS_CONST(nv) ((ev_tstamp)((nv) * 1e9 + ((nv) < 0. ? -.5 : .5))) /* constant EV_TS_FROM_SEC */
+# define EV_TS_TO_MSEC(a) (((a) + 999999) / 1000000)
+# define EV_TS_FROM_USEC(us) ((ev_tstamp)(us) * 1000)
+# define EV_TV_SET(tv,t) do { tv.tv_sec = (long)((t) / 1000000000); tv.tv_usec = (long)((t) % 1000000000 / 1000); } while (0)
+# define EV_TS_SET(ts,t) do { ts.tv_sec = (long)((t) / 1000000000); ts.tv_nsec = (long)((t) % 1000000000); } while (0)
+# define EV_TV_GET(tv) ((ev_tstamp)(tv).tv_sec * 1000000000 + (ev_tstamp)(tv).tv_usec * 1000)
+# define EV_TS_GET(ts) ((ev_tstamp)(ts).tv_sec * 1000000000 + (ev_tstamp)(ts).tv_nsec)
+# define EV_TS_TO_NSEC(t) (t)
+# define EV_TS_FROM_NSEC(ns) ((ev_tstamp)(ns))
+#elif !defined EV_TS_CONST
 # define EV_TS_CONST(nv) nv
 # define EV_TS_TO_MSEC(a) a * 1e3 + 0.9999
 # define EV_TS_FROM_USEC(us) us * 1e-6
@@ -601,6 +749,11 @@ struct signalfd_siginfo
 # define EV_TS_GET(ts) ((ts).tv_sec + (ts).tv_nsec * 1e-9)
 #endif
 
+#ifndef EV_TS_TO_NSEC
+# define EV_TS_TO_NSEC(t) ((t) * 1e9)
+# define EV_TS_FROM_NSEC(ns) ((ev_tstamp)(ns) * 1e-9)
+#endif
+
 /* the following is ecb.h embedded into libev - use update_ev_c to update from an external copy */
 /* ECB.H BEGIN */
 /*
@@ -1888,9 +2041,20 @@ static EV_ATOMIC_T have_monotonic; /* did clock_gettime (CLOCK_MONOTONIC) work?
 # include <linux/aio_abi.h> /* probably only needed for aio_context_t */
 #endif
 
-/* define a suitable floor function (only used by periodics atm) */
+/* define a suitable floor function (only used by periodics and timer slack atm) */
+
+#if EV_TSTAMP_INT64
+
+/* integer nanoseconds only need a floor division, as / rounds towards zero */
+inline_size ev_tstamp
+ev_floor_div (ev_tstamp a, ev_tstamp b)
+{
+  ev_tstamp q = a / b;
+
+  return q - (q * b != a && (a < 0) != (b < 0));
+}
 
-#if EV_USE_FLOOR
+#elif EV_USE_FLOOR
 # include <math.h>
 # define ev_floor(v) floor (v)
 #else
@@ -1935,6 +2099,10 @@ ev_floor (ev_tstamp v)
 
 #endif
 
+#if !EV_TSTAMP_INT64
+# define ev_floor_div(a,b) ev_floor ((a) / (b))
+#endif
+
 /*****************************************************************************/
 
 #ifdef __linux
@@ -2076,7 +2244,9 @@ ev_realloc (void *ptr, long size)
 /* file descriptor info structure */
 typedef struct
 {
+#if !EV_FD_SPLIT
   WL head;
+#endif
   unsigned char events; /* the events watched for */
   unsigned char reify;  /* flag set when this ANFD needs reification (EV_ANFD_REIFY, EV__IOFDSET) */
   unsigned char emask;  /* some backends store the actual kernel mask in here */
@@ -2084,14 +2254,67 @@ typedef struct
 #if EV_USE_EPOLL
   unsigned int egen;    /* generation counter to counter epoll bugs */
 #endif
-#if EV_SELECT_IS_WINSOCKET || EV_USE_IOCP
+#if !EV_FD_SPLIT
+# if EV_SELECT_IS_WINSOCKET || EV_USE_IOCP
   SOCKET handle;
-#endif
-#if EV_USE_IOCP
+# endif
+# if EV_USE_IOCP
   OVERLAPPED or, ow;
+# endif
 #endif
 } ANFD;
 
+#if EV_FD_SPLIT
+/* with EV_FD_SPLIT, the above only contains the small per-fd state the */
+/* backends check for every event, and everything else lives in a parallel array */
+typedef struct
+{
+  WL head;
+# if EV_SELECT_IS_WINSOCKET || EV_USE_IOCP
+  SOCKET handle;
+# endif
+# if EV_USE_IOCP
+  OVERLAPPED or, ow;
+# endif
+} ANFDCOLD;
+#endif
+
+#if EV_FD_SPARSE
+/* with EV_FD_SPARSE, the per-fd state is kept in pages of EV_FD_PAGE fds, */
+/* which only get allocated when an fd in them gets watched. all other pages */
+/* point to a shared page of zeroes, so lookups never need to check for them */
+# define EV_FD_PAGE (1 << EV_FD_PAGE_BITS)
+
+typedef struct
+{
+  ANFD fds [EV_FD_PAGE];
+# if EV_FD_SPLIT
+  ANFDCOLD cold [EV_FD_PAGE];
+# endif
+} ANFDPAGE;
+
+static ANFDPAGE anfd_empty; /* never written to */
+
+# define ANFD_page(fd) anfdpages [(fd) >> EV_FD_PAGE_BITS]
+# define ANFD_at(fd)   ANFD_page (fd)->fds [(fd) & (EV_FD_PAGE - 1)]
+# if EV_FD_SPLIT
+#  define ANFD_cold(fd) ANFD_page (fd)->cold [(fd) & (EV_FD_PAGE - 1)]
+# endif
+#else
+# define ANFD_at(fd)   anfds [fd]
+# if EV_FD_SPLIT
+#  define ANFD_cold(fd) anfdcold [fd]
+# endif
+#endif
+
+#if !EV_FD_SPLIT
+# define ANFD_cold(fd) ANFD_at (fd)
+#endif
+
+/* the watcher list and the os handle of an fd */
+#define ANFD_head(fd)   ANFD_cold (fd).head
+#define ANFD_handle(fd) ANFD_cold (fd).handle
+
 /* stores the pending event set for a given watcher */
 typedef struct
 {
@@ -2107,6 +2330,71 @@ typedef struct
 } ANFS;
 #endif
 
+#if EV_USE_IOURING
+/* slot for a completion-based io_uring operation, indexed by user_data */
+typedef struct
+{
+  W w;          /* the ev_uring watcher owning the slot, or 0 if free */
+  uint32_t gen; /* generation counter, to ignore completions for stale operations */
+  int next;     /* next free slot */
+  W cancel;     /* the stopped ev_uring watcher of a cancelled operation, until it completes */
+} ANURING;
+
+/* relative or absolute, reference clock is CLOCK_MONOTONIC */
+struct iouring_kernel_timespec
+{
+  int64_t tv_sec;
+  long long tv_nsec;
+};
+#endif
+
+#if EV_USE_TIMERWHEEL
+/* the wheel has TW_LEVELS levels of TW_SLOTS slots each */
+#define TW_BITS   8
+#define TW_SLOTS  (1 << TW_BITS)
+#define TW_LEVELS 4
+
+/* a timer in the timer wheel, indexed by ev_active - 1 */
+typedef struct
+{
+  WT w;       /* the timer, or 0 if free */
+  int next;   /* next node in the slot, or next free node */
+  int prev;   /* previous node in the slot, or -1 */
+  int slot;   /* the slot the timer is linked into, or -1 while it is being expired */
+} ANTW;
+#endif
+
+#if EV_STATS_ENABLE
+/* ev_set_stats */
+typedef struct
+{
+  ev_stats s;
+  ev_tstamp start;      /* start of the current phase */
+  unsigned int pending; /* number of pending watchers before polling */
+} ANSTATS;
+
+#define EV_PROFILE_TYPES 17 /* EV_IO .. EV_WORK, then everything else */
+#define PROFILE_HASH(cb) ((unsigned int)((uintptr_t)(cb) >> 4) * 2654435761U)
+
+/* ev_set_cb_profile */
+typedef struct
+{
+  ev_tstamp threshold;
+  void (*slow_cb)(EV_P_ void *w, int type, int priority, ev_tstamp duration);
+  ev_cb_profile types [EV_PROFILE_TYPES];
+  ev_cb_profile **cbs;  /* hash table of cbmax (a power of two) entries */
+  unsigned int cbmax;
+  unsigned int cbcnt;
+} ANPROFILE;
+
+/* the watcher types, in the order of their revents bits, see profile_type */
+static const int profile_types [EV_PROFILE_TYPES] = {
+  EV_IO, EV_TIMER, EV_PERIODIC, EV_SIGNAL, EV_CHILD, EV_STAT, EV_IDLE, EV_PREPARE,
+  EV_CHECK, EV_EMBED, EV_FORK, EV_CLEANUP, EV_ASYNC, EV_URING, EV_CHANNEL, EV_WORK,
+  EV_CUSTOM
+};
+#endif
+
 /* Heap Entry */
 #if EV_HEAP_CACHE_AT
   /* a heap element */
@@ -2203,6 +2491,183 @@ get_clock (void)
   return ev_time ();
 }
 
+#if EV_CLOCK_POLICY
+
+/* loops can replace the monotonic clock by a cheaper one, which */
+/* time_update resyncs against the real one every now and then */
+#define CLOCK_POLICY_COARSE 1
+#define CLOCK_POLICY_TSC    2
+#define CLOCK_POLICY_HOLD   3 /* tsc given up while ahead, wait for the monotonic clock */
+
+#if EV_USE_TSC
+inline_speed uint64_t
+tsc_read (void)
+{
+  uint32_t lo, hi;
+
+  __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+
+  return (uint64_t)hi << 32 | lo;
+}
+
+/* only an invariant tsc ticks at a constant rate in all power states */
+ecb_cold
+static int
+tsc_invariant (void)
+{
+  uint32_t a, b, c, d;
+
+  __asm__ ("cpuid" : "=a" (a), "=b" (b), "=c" (c), "=d" (d) : "a" (0x80000000U), "c" (0));
+
+  if (a < 0x80000007U)
+    return 0;
+
+  __asm__ ("cpuid" : "=a" (a), "=b" (b), "=c" (c), "=d" (d) : "a" (0x80000007U), "c" (0));
+
+  return (d >> 8) & 1;
+}
+#endif
+
+inline_speed ev_tstamp
+loop_clock (EV_P)
+{
+#if EV_USE_TSC
+  /* until the first resync has calibrated it, the tsc is not used */
+  if (clock_policy == CLOCK_POLICY_TSC && ecb_expect_true (tsc_scale))
+    return tsc_mono + (ev_tstamp)((double)(int64_t)(tsc_read () - tsc_base) * tsc_scale);
+
+  /* the clock must never go backwards, so stand still until the */
+  /* monotonic clock has caught up with the last tsc-based time */
+  if (ecb_expect_false (clock_policy == CLOCK_POLICY_HOLD))
+    {
+      ev_tstamp mono = get_clock ();
+
+      if (mono < tsc_mono)
+        return tsc_mono;
+
+      clock_policy = 0;
+      return mono;
+    }
+#endif
+
+#if EV_USE_COARSECLOCK
+  if (clock_policy == CLOCK_POLICY_COARSE)
+    {
+      struct timespec ts;
+      clock_gettime (CLOCK_MONOTONIC_COARSE, &ts);
+      return EV_TS_GET (ts);
+    }
+#endif
+
+  return get_clock ();
+}
+
+ecb_cold
+static void
+clock_init (EV_P_ unsigned int flags)
+{
+  clock_policy    = 0;
+  clock_res       = EV_TS_CONST (0.);
+  clock_maxdrift  = EV_TS_CONST (0.);
+  clock_resynccnt = 0;
+
+  if (!have_monotonic)
+    return;
+
+#if EV_USE_TSC
+  if ((flags & EVFLAG_TSCCLOCK) && tsc_invariant ())
+    {
+      clock_policy = CLOCK_POLICY_TSC;
+      tsc_scale    = 0.;
+      tsc_cal      = tsc_read ();
+      tsc_calmono  = get_clock ();
+      return;
+    }
+#endif
+
+#if EV_USE_COARSECLOCK
+  if (flags & EVFLAG_COARSECLOCK)
+    {
+      struct timespec ts;
+
+      if (!clock_getres (CLOCK_MONOTONIC_COARSE, &ts))
+        {
+          clock_policy = CLOCK_POLICY_COARSE;
+          clock_res    = EV_TS_GET (ts);
+        }
+    }
+#endif
+}
+
+/* compare the loop clock against the monotonic clock, record the drift, */
+/* recalibrate the tsc, and return the new loop time, which is never */
+/* earlier than the old one, as long as the drift stays reasonable */
+ecb_noinline
+static ev_tstamp
+clock_resync (EV_P)
+{
+  ev_tstamp now, mono, drift;
+#if EV_USE_TSC
+  uint64_t tsc = tsc_read ();
+#endif
+
+  now   = loop_clock (EV_A);
+  mono  = get_clock ();
+  drift = now < mono ? mono - now : now - mono;
+
+  ++clock_resynccnt;
+
+  if (drift > clock_maxdrift)
+    clock_maxdrift = drift;
+
+#if EV_USE_TSC
+  if (clock_policy == CLOCK_POLICY_TSC)
+    {
+      /* calibrate over the whole lifetime of the loop, for best accuracy */
+      double ticks = (double)(int64_t)(tsc - tsc_cal);
+      double scale;
+
+      if (ecb_expect_false (!(ticks > 0.) || drift > EV_TS_CONST (MIN_TIMEJUMP * .5)))
+        {
+          /* the tsc went backwards, or stopped, so give up on it, */
+          /* without stepping back if it was ahead */
+          if (now > mono)
+            {
+              clock_policy = CLOCK_POLICY_HOLD;
+              tsc_mono     = now;
+              return now;
+            }
+
+          clock_policy = 0;
+          return mono;
+        }
+
+      scale    = (double)(mono - tsc_calmono) / ticks;
+      tsc_base = tsc;
+
+      if (now > mono)
+        {
+          /* we are ahead, so run slower until the next resync to catch up */
+          tsc_mono  = now;
+          tsc_scale = scale - (double)(now - mono) * scale / (double)EV_TS_CONST (MIN_TIMEJUMP * .5);
+        }
+      else
+        {
+          tsc_mono  = mono;
+          tsc_scale = scale;
+        }
+
+      return tsc_mono;
+    }
+#endif
+
+  return now;
+}
+
+#else
+# define loop_clock(loop) get_clock ()
+#endif
+
 #if EV_MULTIPLICITY
 ev_tstamp
 ev_now (EV_P) EV_NOEXCEPT
@@ -2357,10 +2822,9 @@ queue_events (EV_P_ W *events, int eventcnt, int type)
 inline_speed void
 fd_event_nocheck (EV_P_ int fd, int revents)
 {
-  ANFD *anfd = anfds + fd;
   ev_io *w;
 
-  for (w = (ev_io *)anfd->head; w; w = (ev_io *)((WL)w)->next)
+  for (w = (ev_io *)ANFD_head (fd); w; w = (ev_io *)((WL)w)->next)
     {
       int ev = w->events & revents;
 
@@ -2374,7 +2838,7 @@ fd_event_nocheck (EV_P_ int fd, int revents)
 inline_speed void
 fd_event (EV_P_ int fd, int revents)
 {
-  ANFD *anfd = anfds + fd;
+  ANFD *anfd = &ANFD_at (fd);
 
   if (ecb_expect_true (!anfd->reify))
     fd_event_nocheck (EV_A_ fd, revents);
@@ -2387,6 +2851,57 @@ ev_feed_fd_event (EV_P_ int fd, int revents) EV_NOEXCEPT
     fd_event_nocheck (EV_A_ fd, revents);
 }
 
+#if EV_USE_EPOLL
+/* backends call this for events a few entries ahead in their result batch, */
+/* as with many fds, the per-fd state of consecutive events is usually scattered */
+inline_speed void
+fd_prefetch (EV_P_ int fd)
+{
+  ecb_prefetch (&ANFD_at (fd), 1, 3);
+#if EV_FD_SPLIT
+  ecb_prefetch (&ANFD_cold (fd), 0, 3);
+#endif
+}
+#endif
+
+/* make sure the per-fd arrays are large enough to hold the given fd */
+inline_size void
+fd_needsize (EV_P_ int fd)
+{
+#if EV_FD_SPARSE
+  if (ecb_expect_false (fd >= anfdmax))
+    {
+      int ocur = anfdmax >> EV_FD_PAGE_BITS;
+      int pagemax = ocur;
+
+      anfdpages = (ANFDPAGE **)array_realloc (sizeof (ANFDPAGE *), anfdpages, &pagemax, (fd >> EV_FD_PAGE_BITS) + 1);
+
+      while (ocur < pagemax)
+        anfdpages [ocur++] = &anfd_empty;
+
+      anfdmax = pagemax << EV_FD_PAGE_BITS;
+    }
+
+  if (ecb_expect_false (ANFD_page (fd) == &anfd_empty))
+    {
+      ANFD_page (fd) = (ANFDPAGE *)ev_malloc (sizeof (ANFDPAGE));
+      memset ((void *)ANFD_page (fd), 0, sizeof (ANFDPAGE));
+    }
+#elif EV_FD_SPLIT
+  int ocur = anfdmax;
+
+  if (ecb_expect_false (fd >= anfdmax))
+    {
+      anfds    = (ANFD     *)array_realloc (sizeof (ANFD), anfds, &anfdmax, fd + 1);
+      anfdcold = (ANFDCOLD *)ev_realloc (anfdcold, sizeof (ANFDCOLD) * anfdmax);
+      memset ((void *)(anfds    + ocur), 0, sizeof (ANFD    ) * (anfdmax - ocur));
+      memset ((void *)(anfdcold + ocur), 0, sizeof (ANFDCOLD) * (anfdmax - ocur));
+    }
+#else
+  array_needsize (ANFD, anfds, anfdmax, fd + 1, array_needsize_zerofill);
+#endif
+}
+
 /* make sure the external fd watch events are in-sync */
 /* with the kernel/libev internal state */
 inline_size void
@@ -2410,13 +2925,13 @@ fd_reify (EV_P)
   for (i = 0; i < changecnt; ++i)
     {
       int fd = fdchanges [i];
-      ANFD *anfd = anfds + fd;
+      ANFD *anfd = &ANFD_at (fd);
 
-      if (anfd->reify & EV__IOFDSET && anfd->head)
+      if (anfd->reify & EV__IOFDSET && ANFD_head (fd))
         {
           SOCKET handle = EV_FD_TO_WIN32_HANDLE (fd);
 
-          if (handle != anfd->handle)
+          if (handle != ANFD_handle (fd))
             {
               unsigned long arg;
 
@@ -2425,7 +2940,7 @@ fd_reify (EV_P)
               /* handle changed, but fd didn't - we need to do it in two steps */
               backend_modify (EV_A_ fd, anfd->events, 0);
               anfd->events = 0;
-              anfd->handle = handle;
+              ANFD_handle (fd) = handle;
             }
         }
     }
@@ -2434,7 +2949,7 @@ fd_reify (EV_P)
   for (i = 0; i < changecnt; ++i)
     {
       int fd = fdchanges [i];
-      ANFD *anfd = anfds + fd;
+      ANFD *anfd = &ANFD_at (fd);
       ev_io *w;
 
       unsigned char o_events = anfd->events;
@@ -2444,17 +2959,31 @@ fd_reify (EV_P)
 
       /*if (ecb_expect_true (o_reify & EV_ANFD_REIFY)) probably a deoptimisation */
         {
+          /* the fd is only edge-triggered or exclusive if all watchers agree to it */
+          unsigned char flags = EV_EDGE | EV_EXCLUSIVE;
+
           anfd->events = 0;
 
-          for (w = (ev_io *)anfd->head; w; w = (ev_io *)((WL)w)->next)
-            anfd->events |= (unsigned char)w->events;
+          for (w = (ev_io *)ANFD_head (fd); w; w = (ev_io *)((WL)w)->next)
+            {
+              anfd->events |= (unsigned char)w->events;
+              flags &= (unsigned char)w->events;
+            }
+
+          anfd->events &= ~(EV_EDGE | EV_EXCLUSIVE);
+
+          if (anfd->events)
+            anfd->events |= flags;
 
           if (o_events != anfd->events)
             o_reify = EV__IOFDSET; /* actually |= */
         }
 
       if (o_reify & EV__IOFDSET)
-        backend_modify (EV_A_ fd, o_events, anfd->events);
+        {
+          PROBE3 (fd_modify, fd, (int)o_events, (int)anfd->events);
+          backend_modify (EV_A_ fd, o_events, anfd->events);
+        }
     }
 
   /* normally, fdchangecnt hasn't changed. if it has, then new fds have been added.
@@ -2472,8 +3001,8 @@ inline_size
 void
 fd_change (EV_P_ int fd, int flags)
 {
-  unsigned char reify = anfds [fd].reify;
-  anfds [fd].reify = reify | flags;
+  unsigned char reify = ANFD_at (fd).reify;
+  ANFD_at (fd).reify = reify | flags;
 
   if (ecb_expect_true (!reify))
     {
@@ -2489,7 +3018,7 @@ fd_kill (EV_P_ int fd)
 {
   ev_io *w;
 
-  while ((w = (ev_io *)anfds [fd].head))
+  while ((w = (ev_io *)ANFD_head (fd)))
     {
       ev_io_stop (EV_A_ w);
       ev_feed_event (EV_A_ (W)w, EV_ERROR | EV_READ | EV_WRITE);
@@ -2515,7 +3044,7 @@ fd_ebadf (EV_P)
   int fd;
 
   for (fd = 0; fd < anfdmax; ++fd)
-    if (anfds [fd].events)
+    if (ANFD_at (fd).events)
       if (!fd_valid (fd) && errno == EBADF)
         fd_kill (EV_A_ fd);
 }
@@ -2528,7 +3057,7 @@ fd_enomem (EV_P)
   int fd;
 
   for (fd = anfdmax; fd--; )
-    if (anfds [fd].events)
+    if (ANFD_at (fd).events)
       {
         fd_kill (EV_A_ fd);
         break;
@@ -2543,10 +3072,10 @@ fd_rearm_all (EV_P)
   int fd;
 
   for (fd = 0; fd < anfdmax; ++fd)
-    if (anfds [fd].events)
+    if (ANFD_at (fd).events)
       {
-        anfds [fd].events = 0;
-        anfds [fd].emask  = 0;
+        ANFD_at (fd).events = 0;
+        ANFD_at (fd).emask  = 0;
         fd_change (EV_A_ fd, EV__IOFDSET | EV_ANFD_REIFY);
       }
 }
@@ -2710,25 +3239,403 @@ reheap (ANHE *heap, int N)
     upheap (heap, i + HEAP0);
 }
 
-/*****************************************************************************/
+/* build a heap from N unordered elements in O(N), using floyds algorithm, */
+/* by sifting down every inner node, starting with the last one */
+inline_size void
+heapify (ANHE *heap, int N)
+{
+  int k;
 
-/* associate signal watchers to a signal */
-typedef struct
+  if (N > 1)
+    for (k = HPARENT (N - 1 + HEAP0); k >= HEAP0; --k)
+      downheap (heap, N, k);
+}
+
+/* restore the heap property after appending the elements from old to N */
+/* few new elements are cheaper to sift up, many are cheaper to heapify */
+inline_size void
+heap_append (ANHE *heap, int N, int old)
 {
-  EV_ATOMIC_T pending;
-#if EV_MULTIPLICITY
-  EV_P;
-#endif
-  WL head;
-} ANSIG;
+  int i;
 
-static ANSIG signals [EV_NSIG - 1];
+  if (N - old < old)
+    for (i = old; i < N; ++i)
+      upheap (heap, i + HEAP0);
+  else
+    heapify (heap, N);
+}
 
 /*****************************************************************************/
 
-#if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE
+#if EV_USE_TIMERWHEEL
 
-ecb_noinline ecb_cold
+/*
+ * the timer wheel, used instead of the timer heap with EVFLAG_TIMERWHEEL.
+ * every timer is kept in a doubly-linked slot list, which makes starting,
+ * stopping and restarting timers O(1), regardless of how many are active.
+ * a slot on the lowest level covers EV_TIMERWHEEL_TICK seconds, and every
+ * higher level is TW_SLOTS times coarser. timers on the higher levels are
+ * only redistributed to the lower levels ("cascaded") once the wheel reaches
+ * their slot, and timers further away than the wheel reaches are simply
+ * cascaded more than once. the tick size only affects efficiency, timers
+ * are still invoked at their exact time.
+ */
+
+inline_size uint64_t
+tw_tick (ev_tstamp at)
+{
+  return at > EV_TS_CONST (0.) ? (uint64_t)(at / EV_TS_CONST (EV_TIMERWHEEL_TICK)) : 0;
+}
+
+ecb_cold
+static void
+tw_init (EV_P)
+{
+  int i;
+
+  twheads = (int *)ev_malloc (sizeof (int) * TW_LEVELS * TW_SLOTS);
+
+  for (i = 0; i < TW_LEVELS * TW_SLOTS; ++i)
+    twheads [i] = -1;
+
+  memset (twbits, 0, sizeof (twbits));
+  twtick = tw_tick (mn_now);
+  twfree = -1;
+}
+
+inline_size int
+tw_alloc (EV_P_ WT w)
+{
+  int n = twfree;
+
+  if (n >= 0)
+    twfree = twnodes [n].next;
+  else
+    {
+      n = twnodecnt++;
+      array_needsize (ANTW, twnodes, twnodemax, twnodecnt, array_needsize_noinit);
+    }
+
+  twnodes [n].w = w;
+
+  return n;
+}
+
+inline_size void
+tw_free (EV_P_ int n)
+{
+  twnodes [n].w    = 0;
+  twnodes [n].next = twfree;
+  twfree = n;
+}
+
+/* link a node into the slot matching its timer's expiry time */
+inline_speed void
+tw_link (EV_P_ int n)
+{
+  ANTW *node = twnodes + n;
+  uint64_t tick = tw_tick (ev_at (node->w));
+  int level = 0;
+  int slot;
+
+  if (tick < twtick)
+    tick = twtick;
+
+  /* beyond the reach of the wheel, park it in the farthest slot */
+  if ((tick - twtick) >> (TW_LEVELS * TW_BITS))
+    tick = twtick + ((uint64_t)1 << (TW_LEVELS * TW_BITS)) - 1;
+
+  while (level < TW_LEVELS - 1 && (tick - twtick) >> ((level + 1) * TW_BITS))
+    ++level;
+
+  slot = level * TW_SLOTS + (int)((tick >> (level * TW_BITS)) & (TW_SLOTS - 1));
+
+  node->slot = slot;
+  node->prev = -1;
+  node->next = twheads [slot];
+
+  if (node->next >= 0)
+    twnodes [node->next].prev = n;
+
+  twheads [slot] = n;
+  twbits [slot >> 6] |= (uint64_t)1 << (slot & 63);
+}
+
+inline_speed void
+tw_unlink (EV_P_ int n)
+{
+  ANTW *node = twnodes + n;
+
+  if (node->prev >= 0)
+    twnodes [node->prev].next = node->next;
+  else if ((twheads [node->slot] = node->next) < 0)
+    twbits [node->slot >> 6] &= ~((uint64_t)1 << (node->slot & 63));
+
+  if (node->next >= 0)
+    twnodes [node->next].prev = node->prev;
+
+  node->slot = -1;
+}
+
+/* empty a slot, returning its first node - the nodes stay chained via next */
+inline_size int
+tw_take (EV_P_ int slot)
+{
+  int n = twheads [slot];
+
+  twheads [slot] = -1;
+  twbits [slot >> 6] &= ~((uint64_t)1 << (slot & 63));
+
+  return n;
+}
+
+/* find the first used slot on a level, starting at index i and wrapping around */
+inline_size int
+tw_find (EV_P_ int level, int i)
+{
+  uint64_t *bits = twbits + level * (TW_SLOTS / 64);
+  int k;
+
+  for (k = 0; k <= TW_SLOTS / 64; ++k)
+    {
+      int word = ((i >> 6) + k) & (TW_SLOTS / 64 - 1);
+      uint64_t mask = bits [word];
+
+      /* only the part at or after i for the first word, only the part before i when we wrap around to it */
+      if (!k)
+        mask &= ~(uint64_t)0 << (i & 63);
+      else if (k == TW_SLOTS / 64)
+        mask &= ~(~(uint64_t)0 << (i & 63));
+
+      if (mask)
+        return word * 64 + ecb_ctz64 (mask);
+    }
+
+  return -1;
+}
+
+/* the earliest tick at which one of the higher levels needs to be cascaded */
+static uint64_t
+tw_cascade_tick (EV_P)
+{
+  uint64_t tick = ~(uint64_t)0;
+  int level;
+
+  for (level = 1; level < TW_LEVELS; ++level)
+    {
+      uint64_t base = twtick >> (level * TW_BITS);
+      int cur = (int)(base & (TW_SLOTS - 1));
+      int s = tw_find (EV_A_ level, (cur + 1) & (TW_SLOTS - 1));
+
+      /* the current slot is only used by timers one full turn ahead */
+      if (s >= 0)
+        {
+          int d = (s - cur) & (TW_SLOTS - 1);
+          uint64_t to = (base + (d ? d : TW_SLOTS)) << (level * TW_BITS);
+
+          if (to < tick)
+            tick = to;
+        }
+    }
+
+  return tick;
+}
+
+/* the time the loop needs to wake up for the wheel */
+static ev_tstamp
+tw_next (EV_P)
+{
+  ev_tstamp at = EV_TS_CONST (EV_TSTAMP_HUGE);
+  uint64_t tick = tw_cascade_tick (EV_A);
+  int n;
+  int s = tw_find (EV_A_ 0, (int)(twtick & (TW_SLOTS - 1)));
+
+  /* the lowest level is exact, the first used slot has the earliest timer */
+  if (s >= 0)
+    for (n = twheads [s]; n >= 0; n = twnodes [n].next)
+      if (ev_at (twnodes [n].w) < at)
+        at = ev_at (twnodes [n].w);
+
+  if (tick != ~(uint64_t)0 && (ev_tstamp)tick * EV_TS_CONST (EV_TIMERWHEEL_TICK) < at)
+    at = (ev_tstamp)tick * EV_TS_CONST (EV_TIMERWHEEL_TICK);
+
+  return at;
+}
+
+static int
+tw_cmp (const void *a, const void *b)
+{
+  ev_tstamp at_a = ev_at (*(W *)a);
+  ev_tstamp at_b = ev_at (*(W *)b);
+
+  return at_a < at_b ? -1 : at_a > at_b;
+}
+
+/* turn the wheel to mn_now and feed_reverse all expired timers, earliest first */
+static void
+tw_expire (EV_P)
+{
+  uint64_t target = tw_tick (mn_now);
+  int n, next;
+
+  while (twtick < target)
+    {
+      uint64_t to = (twtick | (TW_SLOTS - 1)) + 1;
+      int cur = (int)(twtick & (TW_SLOTS - 1));
+      int level, s;
+
+      /* the current slot ends before mn_now, so all its timers have expired */
+      for (n = tw_take (EV_A_ cur); n >= 0; n = next)
+        {
+          next = twnodes [n].next;
+          twnodes [n].slot = -1;
+          feed_reverse (EV_A_ (W)twnodes [n].w);
+        }
+
+      /* skip ahead to the next used slot, the next cascade or mn_now, whichever comes first */
+      s = tw_find (EV_A_ 0, (cur + 1) & (TW_SLOTS - 1));
+      if (s < 0)
+        to = tw_cascade_tick (EV_A); /* the lowest level is empty, so we can skip unused cascades as well */
+      else if (twtick + ((s - cur) & (TW_SLOTS - 1)) < to)
+        to = twtick + ((s - cur) & (TW_SLOTS - 1));
+
+      twtick = to < target ? to : target;
+
+      /* cascade the higher levels that just entered a new slot, highest first */
+      for (level = TW_LEVELS; --level; )
+        if (!(twtick & (((uint64_t)1 << (level * TW_BITS)) - 1)))
+          for (n = tw_take (EV_A_ level * TW_SLOTS + (int)((twtick >> (level * TW_BITS)) & (TW_SLOTS - 1))); n >= 0; n = next)
+            {
+              next = twnodes [n].next;
+              tw_link (EV_A_ n);
+            }
+    }
+
+  /* the current slot might contain some timers that have expired already */
+  for (n = twheads [twtick & (TW_SLOTS - 1)]; n >= 0; n = next)
+    {
+      next = twnodes [n].next;
+
+      if (ev_at (twnodes [n].w) < mn_now)
+        {
+          tw_unlink (EV_A_ n);
+          feed_reverse (EV_A_ (W)twnodes [n].w);
+        }
+    }
+
+  /* slots are unordered, but timers must be invoked in order */
+  qsort (rfeeds, rfeedcnt, sizeof (W), tw_cmp);
+}
+
+#endif
+
+/*****************************************************************************/
+
+/*
+ * the few atomic operations needed by the lock-free queues for signals, async
+ * and channel watchers. where no lock-free versions are available, the
+ * signals and async watchers scan for pending events instead, and channels
+ * fall back to a mutex.
+ */
+#if ECB_GCC_VERSION(4,1) || defined __clang__ || defined __INTEL_COMPILER
+# define EV_ATOMIC_OPS 1
+# define ev_atomic_cas_ptr(p,o,n) __sync_val_compare_and_swap ((p), (o), (n))
+# define ev_atomic_xchg_ptr(p,n)  (__sync_synchronize (), __sync_lock_test_and_set ((p), (n)))
+# define ev_atomic_xchg_int(p,n)  (__sync_synchronize (), __sync_lock_test_and_set ((p), (n)))
+# define ev_atomic_add_int(p,n)   __sync_fetch_and_add ((p), (n))
+# define ev_atomic_or_int(p,n)    __sync_fetch_and_or ((p), (n))
+#elif defined _WIN32 && _MSC_VER >= 1400
+# define EV_ATOMIC_OPS 1
+# define ev_atomic_cas_ptr(p,o,n) InterlockedCompareExchangePointer ((PVOID volatile *)(p), (n), (o))
+# define ev_atomic_xchg_ptr(p,n)  InterlockedExchangePointer ((PVOID volatile *)(p), (n))
+# define ev_atomic_xchg_int(p,n)  InterlockedExchange ((LONG volatile *)(p), (n))
+# define ev_atomic_add_int(p,n)   InterlockedExchangeAdd ((LONG volatile *)(p), (n))
+# define ev_atomic_or_int(p,n)    _InterlockedOr ((LONG volatile *)(p), (n))
+#else
+# define EV_ATOMIC_OPS 0
+# if EV_CHANNEL_ENABLE || EV_WORK_ENABLE
+#  include <pthread.h>
+
+static pthread_mutex_t atomic_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void *
+atomic_cas_ptr (void **p, void *o, void *n)
+{
+  void *prev;
+
+  pthread_mutex_lock (&atomic_lock);
+  if ((prev = *p) == o)
+    *p = n;
+  pthread_mutex_unlock (&atomic_lock);
+
+  return prev;
+}
+
+static void *
+atomic_xchg_ptr (void **p, void *n)
+{
+  void *prev;
+
+  pthread_mutex_lock (&atomic_lock);
+  prev = *p;
+  *p = n;
+  pthread_mutex_unlock (&atomic_lock);
+
+  return prev;
+}
+
+static int
+atomic_xchg_int (EV_ATOMIC_T *p, int n)
+{
+  int prev;
+
+  pthread_mutex_lock (&atomic_lock);
+  prev = *p;
+  *p = n;
+  pthread_mutex_unlock (&atomic_lock);
+
+  return prev;
+}
+
+static int
+atomic_add_int (int *p, int n)
+{
+  int prev;
+
+  pthread_mutex_lock (&atomic_lock);
+  prev = *p;
+  *p += n;
+  pthread_mutex_unlock (&atomic_lock);
+
+  return prev;
+}
+
+#  define ev_atomic_cas_ptr(p,o,n) atomic_cas_ptr ((void **)(p), (o), (n))
+#  define ev_atomic_xchg_ptr(p,n)  atomic_xchg_ptr ((void **)(p), (n))
+#  define ev_atomic_xchg_int(p,n)  atomic_xchg_int ((p), (n))
+#  define ev_atomic_add_int(p,n)   atomic_add_int ((p), (n))
+# endif
+#endif
+
+/*****************************************************************************/
+
+/* associate signal watchers to a signal */
+typedef struct
+{
+  EV_ATOMIC_T pending;
+#if EV_MULTIPLICITY
+  EV_P;
+#endif
+  WL head;
+} ANSIG;
+
+static ANSIG signals [EV_NSIG - 1];
+
+/*****************************************************************************/
+
+#if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE || EV_CHANNEL_ENABLE || EV_WORK_ENABLE
+
+ecb_noinline ecb_cold
 static void
 evpipe_init (EV_P)
 {
@@ -2822,8 +3729,119 @@ evpipe_write (EV_P_ EV_ATOMIC_T *flag)
     }
 }
 
+#if (EV_ASYNC_ENABLE && EV_ATOMIC_OPS) || EV_CHANNEL_ENABLE || EV_WORK_ENABLE
+
+/*
+ * async and channel watchers that have been sent to are pushed onto a
+ * lock-free stack, so pipecb only has to look at those. a watcher is on
+ * the stack while its sent flag is set, except for the short time between
+ * a sender setting the flag and pushing it, and next is the offset of the
+ * member linking it to the next one.
+ */
+#define SENT_NEXT(w,next) (*(W *)((char *)(w) + (next)))
+
+inline_speed void
+sent_push (W *stack, W w, size_t next)
+{
+  W head, prev;
+
+  for (head = *stack; ; head = prev)
+    {
+      SENT_NEXT (w, next) = head;
+
+      if ((prev = (W)ev_atomic_cas_ptr (stack, head, w)) == head)
+        break;
+    }
+}
+
+/* remove a watcher from the stack, when it is started or stopped, */
+/* returns false if it wasn't there (yet), so its sent flag must stay set */
+ecb_noinline
+static int
+sent_remove (W *stack, W w, size_t next)
+{
+  W list = (W)ev_atomic_xchg_ptr (stack, 0);
+  W *prev = &list;
+  W tail = 0;
+  int found = 0;
+
+  while (*prev)
+    if (*prev == w)
+      {
+        *prev = SENT_NEXT (w, next);
+        found = 1;
+      }
+    else
+      {
+        tail = *prev;
+        prev = &SENT_NEXT (tail, next);
+      }
+
+  /* put the others back, on top of any pushed in the meantime */
+  if (list)
+    {
+      W head, old;
+
+      for (head = *stack; ; head = old)
+        {
+          SENT_NEXT (tail, next) = head;
+
+          if ((old = (W)ev_atomic_cas_ptr (stack, head, list)) == head)
+            break;
+        }
+    }
+
+  return found;
+}
+
+#endif
+
+#if EV_CHANNEL_ENABLE
+
+/* move all messages sent so far to the receive list, in the order they were sent */
+static void
+channel_drain (ev_channel *w)
+{
+  ev_channel_msg *msg, *last;
+  ev_channel_msg *msgs = 0;
+  int n = 0;
+
+  /* producers push onto a stack, so we take all of it and reverse it */
+  last = msg = (ev_channel_msg *)ev_atomic_xchg_ptr (&w->queue, 0);
+
+  if (!msg)
+    return;
+
+  do
+    {
+      ev_channel_msg *next = msg->next;
+
+      msg->next = msgs;
+      msgs = msg;
+      msg = next;
+      ++n;
+    }
+  while (msg);
+
+  if (w->msgs)
+    w->last->next = msgs;
+  else
+    w->msgs = msgs;
+
+  w->last = last;
+
+  if (w->limit)
+    ev_atomic_add_int (&w->count, -n);
+}
+
+#endif
+
+#if EV_WORK_ENABLE
+static void work_reap (EV_P);
+#endif
+
 /* called whenever the libev signal pipe */
-/* got some events (signal, async) */
+/* got some events (signal, async, channel, work) */
 static void
 pipecb (EV_P_ ev_io *iow, int revents)
 {
@@ -2865,9 +3883,27 @@ pipecb (EV_P_ ev_io *iow, int revents)
 
       ECB_MEMORY_FENCE;
 
+#if EV_ATOMIC_OPS
+      for (i = 0; i < (int)(sizeof (sig_bits) / sizeof (sig_bits [0])); ++i)
+        if (sig_bits [i])
+          {
+            unsigned int bits = ev_atomic_xchg_int (&sig_bits [i], 0);
+
+            while (bits)
+              {
+                int signum = i * 32 + ecb_ctz32 (bits);
+
+                bits &= bits - 1;
+
+                if (ecb_expect_false (signals [signum].pending))
+                  ev_feed_signal_event (EV_A_ signum + 1);
+              }
+          }
+#else
       for (i = EV_NSIG - 1; i--; )
         if (ecb_expect_false (signals [i].pending))
           ev_feed_signal_event (EV_A_ i + 1);
+#endif
     }
 #endif
 
@@ -2878,6 +3914,21 @@ pipecb (EV_P_ ev_io *iow, int revents)
 
       ECB_MEMORY_FENCE;
 
+#if EV_ATOMIC_OPS
+      {
+        ev_async *w, *next;
+
+        for (w = (ev_async *)ev_atomic_xchg_ptr (&async_sent, 0); w; w = next)
+          {
+            next = w->sent_next;
+            w->sent = 0;
+            ECB_MEMORY_FENCE_RELEASE;
+
+            if (ecb_expect_true (ev_is_active (w)))
+              ev_feed_event (EV_A_ w, EV_ASYNC);
+          }
+      }
+#else
       for (i = asynccnt; i--; )
         if (asyncs [i]->sent)
           {
@@ -2885,6 +3936,45 @@ pipecb (EV_P_ ev_io *iow, int revents)
             ECB_MEMORY_FENCE_RELEASE;
             ev_feed_event (EV_A_ asyncs [i], EV_ASYNC);
           }
+#endif
+    }
+#endif
+
+#if EV_CHANNEL_ENABLE
+  if (channel_pending)
+    {
+      channel_pending = 0;
+
+      ECB_MEMORY_FENCE;
+
+      {
+        ev_channel *w, *next;
+
+        for (w = (ev_channel *)ev_atomic_xchg_ptr (&channel_sent, 0); w; w = next)
+          {
+            next = w->sent_next;
+            w->sent = 0;
+            ECB_MEMORY_FENCE;
+
+            /* messages stay queued until the watcher is started */
+            if (ecb_expect_true (ev_is_active (w)) && w->queue)
+              {
+                channel_drain (w);
+                ev_feed_event (EV_A_ w, EV_CHANNEL);
+              }
+          }
+      }
+    }
+#endif
+
+#if EV_WORK_ENABLE
+  if (work_pending)
+    {
+      work_pending = 0;
+
+      ECB_MEMORY_FENCE;
+
+      work_reap (EV_A);
     }
 #endif
 }
@@ -2904,6 +3994,9 @@ ev_feed_signal (int signum) EV_NOEXCEPT
 #endif
 
   signals [signum - 1].pending = 1;
+#if EV_ATOMIC_OPS
+  ev_atomic_or_int (&sig_bits [(signum - 1) >> 5], 1U << ((signum - 1) & 31));
+#endif
   evpipe_write (EV_A_ &sig_pending);
 }
 
@@ -3035,7 +4128,7 @@ timerfdcb (EV_P_ ev_io *iow, int revents)
 {
   struct itimerspec its = { 0 };
 
-  its.it_value.tv_sec = ev_rt_now + (int)MAX_BLOCKTIME2;
+  its.it_value.tv_sec = EV_TS_TO_SEC (ev_rt_now) + (int)MAX_BLOCKTIME2;
   timerfd_settime (timerfd, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &its, 0);
 
   ev_rt_now = ev_time ();
@@ -3043,7 +4136,7 @@ timerfdcb (EV_P_ ev_io *iow, int revents)
   /* but maybe in the future we want the full treatment. */
   /*
   now_floor = EV_TS_CONST (0.);
-  time_update (EV_A_ EV_TSTAMP_HUGE);
+  time_update (EV_A_ EV_TS_CONST (EV_TSTAMP_HUGE));
   */
 #if EV_PERIODIC_ENABLE
   periodics_reschedule (EV_A);
@@ -3077,6 +4170,22 @@ evtimerfd_init (EV_P)
 
 /*****************************************************************************/
 
+#if EV_URING_ENABLE
+/* used by the io_uring backend to complete or emulate ev_uring watchers */
+static void uring_done (EV_P_ ev_uring *w, int res);
+static void uring_emulate (EV_P_ ev_uring *w);
+static void uring_buf_take (EV_P_ ev_uring *w, unsigned int bid);
+static void uring_buf_reset (EV_P);
+
+/* whether the operation draws its buffer from the pool */
+inline_size
+int
+uring_pooled (EV_P_ ev_uring *w)
+{
+  return !w->buf && uring_bufcnt && (w->op == EV_URING_READ || w->op == EV_URING_RECV);
+}
+#endif
+
 #if EV_USE_IOCP
 # include "ev_iocp.c"
 #endif
@@ -3209,6 +4318,12 @@ ev_depth (EV_P) EV_NOEXCEPT
   return loop_depth;
 }
 
+unsigned int
+ev_timer_wakeups_saved (EV_P) EV_NOEXCEPT
+{
+  return slack_saved;
+}
+
 void
 ev_set_io_collect_interval (EV_P_ ev_tstamp interval) EV_NOEXCEPT
 {
@@ -3221,6 +4336,35 @@ ev_set_timeout_collect_interval (EV_P_ ev_tstamp interval) EV_NOEXCEPT
   timeout_blocktime = interval;
 }
 
+void
+ev_set_busypoll_interval (EV_P_ ev_tstamp interval) EV_NOEXCEPT
+{
+#if EV_USE_EPOLL
+  if (backend == EVBACKEND_EPOLL)
+    epoll_busypoll_set (EV_A_ interval);
+#endif
+}
+
+unsigned int
+ev_busypoll_spins (EV_P) EV_NOEXCEPT
+{
+#if EV_USE_EPOLL
+  return busypoll_spins;
+#else
+  return 0;
+#endif
+}
+
+unsigned int
+ev_busypoll_hits (EV_P) EV_NOEXCEPT
+{
+#if EV_USE_EPOLL
+  return busypoll_hits;
+#else
+  return 0;
+#endif
+}
+
 void
 ev_set_userdata (EV_P_ void *data) EV_NOEXCEPT
 {
@@ -3247,6 +4391,131 @@ ev_set_loop_release_cb (EV_P_ void (*release)(EV_P) EV_NOEXCEPT, void (*acquire)
 }
 #endif
 
+#if EV_STATS_ENABLE
+void
+ev_set_stats (EV_P_ int enable) EV_NOEXCEPT
+{
+  if (enable)
+    {
+      if (!loop_stats)
+        loop_stats = (ANSTATS *)ev_malloc (sizeof (ANSTATS));
+
+      memset (loop_stats, 0, sizeof (ANSTATS));
+      loop_stats->start = get_clock ();
+    }
+  else if (loop_stats)
+    {
+      ev_free (loop_stats);
+      loop_stats = 0;
+    }
+}
+
+int
+ev_loop_stats (EV_P_ ev_stats *stats) EV_NOEXCEPT
+{
+  if (!loop_stats)
+    return 0;
+
+  *stats = loop_stats->s;
+
+#if EV_CLOCK_POLICY
+  stats->clock_drift   = clock_maxdrift;
+  stats->clock_resyncs = clock_resynccnt;
+#endif
+
+  return 1;
+}
+
+/* the upper bound of the bucket containing the q-quantile */
+static ev_tstamp
+hist_quantile (const unsigned int *hist, double q)
+{
+  unsigned long total = 0, want, sum = 0;
+  int bucket;
+
+  for (bucket = 0; bucket < EV_STATS_BUCKETS; ++bucket)
+    total += hist [bucket];
+
+  if (!total)
+    return 0.;
+
+  want = q <= 0. ? 1 : q >= 1. ? total : (unsigned long)(q * total + .5);
+  if (!want)
+    want = 1;
+
+  for (bucket = 0; bucket < EV_STATS_BUCKETS - 1; ++bucket)
+    if ((sum += hist [bucket]) >= want)
+      break;
+
+  /* the upper bound of the bucket */
+  if (bucket < 16)
+    return EV_TS_FROM_NSEC (bucket + 1);
+  else
+    {
+      int shift = bucket / 8 - 1;
+
+      return EV_TS_FROM_NSEC ((uint64_t)(bucket % 8 + 9) << shift);
+    }
+}
+
+ev_tstamp
+ev_stats_quantile (const ev_stats *stats, int phase, double q) EV_NOEXCEPT
+{
+  return hist_quantile (stats->hist [phase], q);
+}
+
+void
+ev_set_cb_profile (EV_P_ int enable, ev_tstamp threshold, void (*slow_cb)(EV_P_ void *w, int type, int priority, ev_tstamp duration)) EV_NOEXCEPT
+{
+  if (cb_profile)
+    {
+      while (cb_profile->cbmax--)
+        if (cb_profile->cbs [cb_profile->cbmax])
+          ev_free (cb_profile->cbs [cb_profile->cbmax]);
+
+      ev_free (cb_profile->cbs);
+      ev_free (cb_profile);
+      cb_profile = 0;
+    }
+
+  if (enable)
+    {
+      int type;
+
+      cb_profile = (ANPROFILE *)ev_malloc (sizeof (ANPROFILE));
+      memset (cb_profile, 0, sizeof (ANPROFILE));
+      cb_profile->threshold = threshold;
+      cb_profile->slow_cb   = slow_cb;
+
+      for (type = 0; type < EV_PROFILE_TYPES; ++type)
+        cb_profile->types [type].type = profile_types [type];
+    }
+}
+
+void
+ev_cb_profile_walk (EV_P_ void (*cb)(EV_P_ const ev_cb_profile *profile, void *arg), void *arg)
+{
+  unsigned int i;
+
+  if (!cb_profile)
+    return;
+
+  for (i = 0; i < EV_PROFILE_TYPES; ++i)
+    if (cb_profile->types [i].count)
+      cb (EV_A_ cb_profile->types + i, arg);
+
+  for (i = 0; i < cb_profile->cbmax; ++i)
+    if (cb_profile->cbs [i])
+      cb (EV_A_ cb_profile->cbs [i], arg);
+}
+
+ev_tstamp
+ev_cb_profile_quantile (const ev_cb_profile *profile, double q) EV_NOEXCEPT
+{
+  return hist_quantile (profile->hist, q);
+}
+#endif
+
 /* initialise a loop structure, must be zero-initialised */
 ecb_noinline ecb_cold
 static void
@@ -3287,8 +4556,12 @@ loop_init (EV_P_ unsigned int flags) EV_NOEXCEPT
           && getenv ("LIBEV_FLAGS"))
         flags = atoi (getenv ("LIBEV_FLAGS"));
 
+#if EV_CLOCK_POLICY
+      clock_init (EV_A_ flags);
+#endif
+
       ev_rt_now          = ev_time ();
-      mn_now             = get_clock ();
+      mn_now             = loop_clock (EV_A);
       now_floor          = mn_now;
       rtmn_diff          = ev_rt_now - mn_now;
 #if EV_FEATURE_API
@@ -3297,11 +4570,22 @@ loop_init (EV_P_ unsigned int flags) EV_NOEXCEPT
 
       io_blocktime       = 0.;
       timeout_blocktime  = 0.;
+      busypoll_budget    = 0.;
       backend            = 0;
       backend_fd         = -1;
       sig_pending        = 0;
+      memset (sig_bits, 0, sizeof (sig_bits));
 #if EV_ASYNC_ENABLE
       async_pending      = 0;
+      async_sent         = 0;
+#endif
+#if EV_CHANNEL_ENABLE
+      channel_pending    = 0;
+      channel_sent       = 0;
+#endif
+#if EV_WORK_ENABLE
+      work_pending       = 0;
+      work_done          = 0;
 #endif
       pipe_write_skipped = 0;
       pipe_write_wanted  = 0;
@@ -3316,6 +4600,10 @@ loop_init (EV_P_ unsigned int flags) EV_NOEXCEPT
 #if EV_USE_TIMERFD
       timerfd            = flags & EVFLAG_NOTIMERFD ? -1 : -2;
 #endif
+#if EV_USE_TIMERWHEEL
+      if ((flags & EVFLAG_TIMERWHEEL) && have_monotonic)
+        tw_init (EV_A);
+#endif
 
       if (!(flags & EVBACKEND_MASK))
         flags |= ev_recommended_backends ();
@@ -3345,9 +4633,15 @@ loop_init (EV_P_ unsigned int flags) EV_NOEXCEPT
       if (!backend && (flags & EVBACKEND_SELECT  )) backend = select_init    (EV_A_ flags);
 #endif
 
+#if EV_CLOCK_POLICY
+      /* waiting for less than a tick of the coarse clock would just spin */
+      if (backend_mintime < clock_res)
+        backend_mintime = clock_res;
+#endif
+
       ev_prepare_init (&pending_w, pendingcb);
 
-#if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE
+#if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE || EV_CHANNEL_ENABLE || EV_WORK_ENABLE
       ev_init (&pipe_w, pipecb);
       ev_set_priority (&pipe_w, EV_MAXPRI);
 #endif
@@ -3444,12 +4738,33 @@ ev_loop_destroy (EV_P)
 #endif
     }
 
+#if EV_FD_SPARSE
+  for (i = anfdmax >> EV_FD_PAGE_BITS; i--; )
+    if (anfdpages [i] != &anfd_empty)
+      ev_free (anfdpages [i]);
+
+  ev_free (anfdpages); anfdpages = 0; anfdmax = 0;
+#else
   ev_free (anfds); anfds = 0; anfdmax = 0;
+# if EV_FD_SPLIT
+  ev_free (anfdcold); anfdcold = 0;
+# endif
+#endif
 
   /* have to use the microsoft-never-gets-it-right macro */
   array_free (rfeed, EMPTY);
   array_free (fdchange, EMPTY);
   array_free (timer, EMPTY);
+#if EV_USE_TIMERWHEEL
+  ev_free (twheads); twheads = 0;
+  array_free (twnode, EMPTY);
+#endif
+#if EV_URING_ENABLE
+  ev_free (uring_bufs); uring_bufs = 0;
+  ev_free (uring_bufout); uring_bufout = 0;
+  ev_free (uring_buffree); uring_buffree = 0;
+  uring_bufcnt = 0;
+#endif
 #if EV_PERIODIC_ENABLE
   array_free (periodic, EMPTY);
 #endif
@@ -3465,6 +4780,15 @@ ev_loop_destroy (EV_P)
   array_free (async, EMPTY);
 #endif
 
+#if EV_CHANNEL_ENABLE
+  array_free (channel, EMPTY);
+#endif
+
+#if EV_STATS_ENABLE
+  ev_set_stats (EV_A_ 0);
+  ev_set_cb_profile (EV_A_ 0, 0., 0);
+#endif
+
   backend = 0;
 
 #if EV_MULTIPLICITY
@@ -3484,6 +4808,8 @@ inline_size void infy_fork (EV_P);
 inline_size void
 loop_fork (EV_P)
 {
+  PROBE1 (fork, (int)postfork);
+
 #if EV_USE_PORT
   if (backend == EVBACKEND_PORT    ) port_fork     (EV_A);
 #endif
@@ -3524,7 +4850,7 @@ loop_fork (EV_P)
           }
       #endif
       
-      #if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE
+      #if EV_SIGNAL_ENABLE || EV_ASYNC_ENABLE || EV_CHANNEL_ENABLE || EV_WORK_ENABLE
         if (ev_is_active (&pipe_w))
           {
             /* pipe_write_wanted must be false now, so modifying fd vars should be safe */
@@ -3588,9 +4914,39 @@ verify_heap (EV_P_ ANHE *heap, int N)
       assert (("libev: heap condition violated", i == HEAP0 || ANHE_at (heap [HPARENT (i)]) <= ANHE_at (heap [i])));
       assert (("libev: heap at cache mismatch", ANHE_at (heap [i]) == ev_at (ANHE_w (heap [i]))));
 
-      verify_watcher (EV_A_ (W)ANHE_w (heap [i]));
+      verify_watcher (EV_A_ (W)ANHE_w (heap [i]));
+    }
+}
+
+#if EV_USE_TIMERWHEEL
+ecb_noinline ecb_cold
+static void
+verify_wheel (EV_P)
+{
+  int i, n, p;
+  int cnt = 0;
+
+  assert (twnodemax >= twnodecnt);
+
+  for (i = 0; i < twnodecnt; ++i)
+    if (twnodes [i].w)
+      {
+        assert (("libev: active index mismatch in timer wheel", ev_active (twnodes [i].w) == i + 1));
+        verify_watcher (EV_A_ (W)twnodes [i].w);
+        ++cnt;
+      }
+
+  assert (("libev: timer wheel count mismatch", cnt == timercnt));
+
+  for (i = 0; i < TW_LEVELS * TW_SLOTS; ++i)
+    {
+      assert (("libev: timer wheel slot bitmap mismatch", !((twbits [i >> 6] >> (i & 63)) & 1) == (twheads [i] < 0)));
+
+      for (p = -1, n = twheads [i]; n >= 0; p = n, n = twnodes [n].next)
+        assert (("libev: timer wheel slot list corrupted", twnodes [n].w && twnodes [n].slot == i && twnodes [n].prev == p));
     }
 }
+#endif
 
 ecb_noinline ecb_cold
 static void
@@ -3623,7 +4979,12 @@ ev_verify (EV_P) EV_NOEXCEPT
     {
       int j = 0;
 
-      for (w = w2 = anfds [i].head; w; w = w->next)
+#if EV_FD_SPARSE
+      if (ANFD_page (i) == &anfd_empty)
+        assert (("libev: shared empty fd page got modified", !ANFD_at (i).events && !ANFD_at (i).reify && !ANFD_head (i)));
+#endif
+
+      for (w = w2 = ANFD_head (i); w; w = w->next)
         {
           verify_watcher (EV_A_ (W)w);
 
@@ -3638,8 +4999,15 @@ ev_verify (EV_P) EV_NOEXCEPT
         }
     }
 
-  assert (timermax >= timercnt);
-  verify_heap (EV_A_ timers, timercnt);
+#if EV_USE_TIMERWHEEL
+  if (twheads)
+    verify_wheel (EV_A);
+  else
+#endif
+    {
+      assert (timermax >= timercnt);
+      verify_heap (EV_A_ timers, timercnt);
+    }
 
 #if EV_PERIODIC_ENABLE
   assert (periodicmax >= periodiccnt);
@@ -3671,6 +5039,21 @@ ev_verify (EV_P) EV_NOEXCEPT
   array_verify (EV_A_ (W *)asyncs, asynccnt);
 #endif
 
+#if EV_CHANNEL_ENABLE
+  assert (channelmax >= channelcnt);
+  array_verify (EV_A_ (W *)channels, channelcnt);
+#endif
+
+#if EV_USE_IOURING
+  assert (iouring_opmax >= iouring_opcnt);
+  for (i = 0; i < iouring_opcnt; ++i)
+    if (iouring_ops [i].w)
+      {
+        assert (("libev: active index mismatch in io_uring operation slots", ev_active (iouring_ops [i].w) == i + 1));
+        verify_watcher (EV_A_ iouring_ops [i].w);
+      }
+#endif
+
 #if EV_PREPARE_ENABLE
   assert (preparemax >= preparecnt);
   array_verify (EV_A_ (W *)prepares, preparecnt);
@@ -3739,11 +5122,11 @@ ev_invoke (EV_P_ void *w, int revents)
   EV_CB_INVOKE ((W)w, revents);
 }
 
-unsigned int
-ev_pending_count (EV_P) EV_NOEXCEPT
+inline_speed unsigned int
+pending_total (EV_P)
 {
-  int pri;
   unsigned int count = 0;
+  int pri;
 
   for (pri = NUMPRI; pri--; )
     count += pendingcnt [pri];
@@ -3751,6 +5134,179 @@ ev_pending_count (EV_P) EV_NOEXCEPT
   return count;
 }
 
+unsigned int
+ev_pending_count (EV_P) EV_NOEXCEPT
+{
+  return pending_total (EV_A);
+}
+
+#if EV_STATS_ENABLE
+
+/* log-linear histogram: exact below 16ns, then 8 buckets per power of two */
+inline_size unsigned int
+stats_bucket (ev_tstamp d)
+{
+  uint64_t ns = d > EV_TS_CONST (0.) ? (uint64_t)EV_TS_TO_NSEC (d) : 0;
+  unsigned int shift, bucket;
+
+  if (ns < 16)
+    return ns;
+
+  shift = ecb_ld64 (ns) - 3;
+  bucket = shift * 8 + (unsigned int)(ns >> shift);
+
+  return bucket < EV_STATS_BUCKETS ? bucket : EV_STATS_BUCKETS - 1;
+}
+
+/* the phase has ended, -1 starts the first phase of an iteration */
+ecb_noinline
+static void
+stats_mark (EV_P_ int phase)
+{
+  ANSTATS *st = loop_stats;
+  ev_tstamp now = get_clock ();
+
+  if (phase >= 0)
+    {
+      ev_tstamp d = now - st->start;
+
+      st->s.last [phase]  = d;
+      st->s.time [phase] += d;
+      ++st->s.hist [phase][stats_bucket (d)];
+    }
+
+  st->start = now;
+
+  switch (phase)
+    {
+      case EVPHASE_FD_REIFY:
+        st->pending = pending_total (EV_A);
+        break;
+
+      case EVPHASE_POLL:
+        st->s.last_events = pending_total (EV_A) - st->pending;
+        st->s.events += st->s.last_events;
+        break;
+
+      case EVPHASE_TIMERS:
+        {
+          int pri;
+
+          for (pri = NUMPRI; pri--; )
+            st->s.pending [pri] += pendingcnt [pri];
+
+          if (pending_total (EV_A) == st->pending)
+            ++st->s.empty;
+        }
+        break;
+
+      case EVPHASE_INVOKE:
+        ++st->s.iterations;
+        break;
+    }
+}
+
+# define STATS(phase) do { if (ecb_expect_false (loop_stats)) stats_mark (EV_A_ (phase)); } while (0)
+#else
+# define STATS(phase)
+#endif
+
+#if EV_STATS_ENABLE
+
+/* watchers do not know their type, but the events they receive give it away */
+inline_size int
+profile_type (int revents)
+{
+  if (revents & (EV_READ | EV_WRITE))
+    return 0;
+
+  revents &= 0x007fff00; /* EV_TIMER .. EV_WORK */
+
+  return revents ? ecb_ctz32 (revents) - 7 : EV_PROFILE_TYPES - 1;
+}
+
+inline_size void
+profile_record (ev_cb_profile *prof, ev_tstamp d)
+{
+  ++prof->count;
+  prof->time += d;
+
+  if (prof->max < d)
+    prof->max = d;
+
+  ++prof->hist [stats_bucket (d)];
+}
+
+/* find or create the profile of a callback */
+static ev_cb_profile *
+profile_cb (ANPROFILE *prof, void *cb, int type)
+{
+  unsigned int i;
+
+  if (ecb_expect_false (prof->cbcnt * 2 >= prof->cbmax))
+    {
+      ev_cb_profile **cbs = prof->cbs;
+      unsigned int max = prof->cbmax;
+
+      prof->cbmax = max ? max * 2 : 64;
+      prof->cbs = (ev_cb_profile **)ev_malloc (sizeof (ev_cb_profile *) * prof->cbmax);
+      memset (prof->cbs, 0, sizeof (ev_cb_profile *) * prof->cbmax);
+
+      while (max--)
+        if (cbs [max])
+          {
+            for (i = PROFILE_HASH (cbs [max]->cb) & (prof->cbmax - 1); prof->cbs [i]; i = (i + 1) & (prof->cbmax - 1))
+              ;
+
+            prof->cbs [i] = cbs [max];
+          }
+
+      ev_free (cbs);
+    }
+
+  for (i = PROFILE_HASH (cb) & (prof->cbmax - 1); prof->cbs [i]; i = (i + 1) & (prof->cbmax - 1))
+    if (prof->cbs [i]->cb == cb)
+      return prof->cbs [i];
+
+  prof->cbs [i] = (ev_cb_profile *)ev_malloc (sizeof (ev_cb_profile));
+  memset (prof->cbs [i], 0, sizeof (ev_cb_profile));
+  prof->cbs [i]->cb   = cb;
+  prof->cbs [i]->type = profile_types [type];
+  ++prof->cbcnt;
+
+  return prof->cbs [i];
+}
+
+ecb_noinline
+static void
+profile_invoke (EV_P_ W w, int revents)
+{
+  /* the callback might stop or even free the watcher, so look at it first */
+  void *cb = (void *)w->cb;
+  int pri = ev_priority (w);
+  int type = profile_type (revents);
+  ev_tstamp start = get_clock ();
+  ev_tstamp d;
+
+  EV_CB_INVOKE (w, revents);
+
+  d = get_clock () - start;
+
+  /* ... and it might have switched off profiling */
+  if (ecb_expect_true (cb_profile))
+    {
+      ANPROFILE *prof = cb_profile;
+
+      profile_record (prof->types + type, d);
+      profile_record (profile_cb (prof, cb, type), d);
+
+      if (d >= prof->threshold && prof->slow_cb)
+        prof->slow_cb (EV_A_ (void *)w, profile_types [type], pri, d);
+    }
+}
+
+#endif
+
 ecb_noinline
 void
 ev_invoke_pending (EV_P)
@@ -3765,9 +5321,19 @@ ev_invoke_pending (EV_P)
       while (pendingcnt [pendingpri])
         {
           ANPENDING *p = pendings [pendingpri] + --pendingcnt [pendingpri];
-
-          p->w->pending = 0;
-          EV_CB_INVOKE (p->w, p->events);
+          /* the callback might reuse or reallocate the pendings slot p points to */
+          W w = p->w;
+
+          w->pending = 0;
+          /* watchers do not know their type, the revents bits give it away */
+          PROBE4 (invoke, (void *)w, (void *)w->cb, p->events, pendingpri + EV_MINPRI);
+#if EV_STATS_ENABLE
+          if (ecb_expect_false (cb_profile))
+            profile_invoke (EV_A_ w, p->events);
+          else
+#endif
+            EV_CB_INVOKE (w, p->events);
+          PROBE1 (invoke_done, (void *)w);
           EV_FREQUENT_CHECK;
         }
     }
@@ -3799,20 +5365,129 @@ idle_reify (EV_P)
 }
 #endif
 
+/* the time the earliest timer expires, timercnt must be nonzero */
+inline_size ev_tstamp
+timers_next (EV_P)
+{
+#if EV_USE_TIMERWHEEL
+  if (ecb_expect_false (twheads))
+    return tw_next (EV_A);
+#endif
+
+  return ANHE_at (timers [HEAP0]);
+}
+
+/* the slack is only valid after ev_timer_set_slack, as ev_init leaves it alone */
+inline_speed int
+timer_slacked (ev_timer *w)
+{
+  return ecb_expect_false (w->wflags & EV__WF_SLACK) && w->slack >= EV_TS_CONST (MIN_SLACK);
+}
+
+/* move the deadline of a timer with slack to the end of its slack bucket. */
+/* buckets are sized to the largest power of two not exceeding the slack, */
+/* so all timers with slack share the same bucket boundaries, and all */
+/* timers in a bucket expire together, with a single wakeup */
+inline_speed void
+timer_slack (ev_timer *w)
+{
+  if (timer_slacked (w))
+    {
+      ev_tstamp bucket = EV_TS_CONST (MIN_SLACK);
+      ev_tstamp at;
+
+      while (bucket + bucket <= w->slack && bucket < EV_TS_CONST (MAX_SLACK))
+        bucket += bucket;
+
+      /* bucket is a power of two, so this is exact */
+      at = ev_floor_div (ev_at (w), bucket) * bucket;
+      ev_at (w) = at < ev_at (w) ? at + bucket : at;
+    }
+}
+
+/* of n timers expiring in one go, the ones with slack might have needed */
+/* a wakeup of their own, but at least one wakeup was needed anyway */
+inline_size void
+timer_slack_saved (EV_P_ int n, int slacked)
+{
+#if EV_FEATURE_API
+  slack_saved += slacked < n ? slacked : n - 1;
+#endif
+}
+
 /* make timers pending */
 inline_size void
 timers_reify (EV_P)
 {
   EV_FREQUENT_CHECK;
 
+#if EV_USE_TIMERWHEEL
+  if (ecb_expect_false (twheads))
+    {
+      int i;
+
+      if (!timercnt)
+        {
+          twtick = tw_tick (mn_now);
+          return;
+        }
+
+      tw_expire (EV_A);
+
+      if (rfeedcnt)
+        {
+          int slacked = 0;
+
+          for (i = 0; i < rfeedcnt; ++i)
+            {
+              ev_timer *w = (ev_timer *)rfeeds [i];
+
+              PROBE2 (timer_expire, (void *)w, PROBE_NSEC (mn_now - ev_at (w)));
+
+              slacked += timer_slacked (w);
+
+              /* first reschedule or stop timer */
+              if (w->repeat)
+                {
+                  ev_at (w) += w->repeat;
+                  if (ev_at (w) < mn_now)
+                    ev_at (w) = mn_now;
+
+                  timer_slack (w);
+
+                  assert (("libev: negative ev_timer repeat value found while processing timers", w->repeat > EV_TS_CONST (0.)));
+
+                  tw_link (EV_A_ ev_active (w) - 1);
+                }
+              else
+                ev_timer_stop (EV_A_ w); /* nonrepeating: stop timer */
+            }
+
+          timer_slack_saved (EV_A_ rfeedcnt, slacked);
+
+          EV_FREQUENT_CHECK;
+          feed_reverse_done (EV_A_ EV_TIMER);
+        }
+
+      return;
+    }
+#endif
+
   if (timercnt && ANHE_at (timers [HEAP0]) < mn_now)
     {
+      int expired = 0, slacked = 0;
+
       do
         {
           ev_timer *w = (ev_timer *)ANHE_w (timers [HEAP0]);
 
           /*assert (("libev: inactive timer on timer heap detected", ev_is_active (w)));*/
 
+          PROBE2 (timer_expire, (void *)w, PROBE_NSEC (mn_now - ev_at (w)));
+
+          ++expired;
+          slacked += timer_slacked (w);
+
           /* first reschedule or stop timer */
           if (w->repeat)
             {
@@ -3820,6 +5495,8 @@ timers_reify (EV_P)
               if (ev_at (w) < mn_now)
                 ev_at (w) = mn_now;
 
+              timer_slack (w);
+
               assert (("libev: negative ev_timer repeat value found while processing timers", w->repeat > EV_TS_CONST (0.)));
 
               ANHE_at_cache (timers [HEAP0]);
@@ -3833,6 +5510,7 @@ timers_reify (EV_P)
         }
       while (timercnt && ANHE_at (timers [HEAP0]) < mn_now);
 
+      timer_slack_saved (EV_A_ expired, slacked);
       feed_reverse_done (EV_A_ EV_TIMER);
     }
 }
@@ -3843,8 +5521,8 @@ ecb_noinline
 static void
 periodic_recalc (EV_P_ ev_periodic *w)
 {
-  ev_tstamp interval = w->interval > MIN_INTERVAL ? w->interval : MIN_INTERVAL;
-  ev_tstamp at = w->offset + interval * ev_floor ((ev_rt_now - w->offset) / interval);
+  ev_tstamp interval = w->interval > EV_TS_CONST (MIN_INTERVAL) ? w->interval : EV_TS_CONST (MIN_INTERVAL);
+  ev_tstamp at = w->offset + interval * ev_floor_div (ev_rt_now - w->offset, interval);
 
   /* the above almost always errs on the low side */
   while (at <= ev_rt_now)
@@ -3878,6 +5556,8 @@ periodics_reify (EV_P)
 
           /*assert (("libev: inactive timer on periodic heap detected", ev_is_active (w)));*/
 
+          PROBE2 (periodic_expire, (void *)w, PROBE_NSEC (ev_rt_now - ev_at (w)));
+
           /* first reschedule or stop timer */
           if (w->reschedule_cb)
             {
@@ -3938,6 +5618,21 @@ timers_reschedule (EV_P_ ev_tstamp adjust)
 {
   int i;
 
+#if EV_USE_TIMERWHEEL
+  if (ecb_expect_false (twheads))
+    {
+      for (i = 0; i < twnodecnt; ++i)
+        if (twnodes [i].w)
+          {
+            tw_unlink (EV_A_ i);
+            twnodes [i].w->at += adjust;
+            tw_link (EV_A_ i);
+          }
+
+      return;
+    }
+#endif
+
   for (i = 0; i < timercnt; ++i)
     {
       ANHE *he = timers + i + HEAP0;
@@ -3957,7 +5652,7 @@ time_update (EV_P_ ev_tstamp max_block)
       int i;
       ev_tstamp odiff = rtmn_diff;
 
-      mn_now = get_clock ();
+      mn_now = loop_clock (EV_A);
 
       /* only fetch the realtime clock every 0.5*MIN_TIMEJUMP seconds */
       /* interpolate in the meantime */
@@ -3967,6 +5662,11 @@ time_update (EV_P_ ev_tstamp max_block)
           return;
         }
 
+#if EV_CLOCK_POLICY
+      if (ecb_expect_false (clock_policy))
+        mn_now = clock_resync (EV_A);
+#endif
+
       now_floor = mn_now;
       ev_rt_now = ev_time ();
 
@@ -3989,7 +5689,7 @@ time_update (EV_P_ ev_tstamp max_block)
             return; /* all is well */
 
           ev_rt_now = ev_time ();
-          mn_now    = get_clock ();
+          mn_now    = loop_clock (EV_A);
           now_floor = mn_now;
         }
 
@@ -4032,6 +5732,8 @@ ev_run (EV_P_ int flags)
 
   do
     {
+      PROBE (iteration);
+
 #if EV_VERIFY >= 2
       ev_verify (EV_A);
 #endif
@@ -4071,9 +5773,13 @@ ev_run (EV_P_ int flags)
       if (ecb_expect_false (postfork))
         loop_fork (EV_A);
 
+      STATS (-1);
+
       /* update fd-related kernel structures */
       fd_reify (EV_A);
 
+      STATS (EVPHASE_FD_REIFY);
+
       /* calculate blocking time */
       {
         ev_tstamp waittime  = 0.;
@@ -4108,7 +5814,7 @@ ev_run (EV_P_ int flags)
 
             if (timercnt)
               {
-                ev_tstamp to = ANHE_at (timers [HEAP0]) - mn_now;
+                ev_tstamp to = timers_next (EV_A) - mn_now;
                 if (waittime > to) waittime = to;
               }
 
@@ -4132,6 +5838,8 @@ ev_run (EV_P_ int flags)
             if (ecb_expect_false (waittime < backend_mintime))
               waittime = waittime <= EV_TS_CONST (0.)
                  ? EV_TS_CONST (0.)
+                 : waittime <= busypoll_budget
+                 ? waittime /* the backend spins that away, no need to oversleep */
                  : backend_mintime;
 
             /* extra check because io_blocktime is commonly 0 */
@@ -4154,7 +5862,17 @@ ev_run (EV_P_ int flags)
         ++loop_count;
 #endif
         assert ((loop_done = EVBREAK_RECURSE, 1)); /* assert for side effect */
+#if EV_USE_USDT
+        {
+          unsigned int pending = pending_total (EV_A);
+
+          PROBE1 (poll, PROBE_NSEC (waittime));
+          backend_poll (EV_A_ waittime);
+          PROBE1 (poll_done, (int)(pending_total (EV_A) - pending));
+        }
+#else
         backend_poll (EV_A_ waittime);
+#endif
         assert ((loop_done = EVBREAK_CANCEL, 1)); /* assert for side effect */
 
         pipe_write_wanted = 0; /* just an optimisation, no fence needed */
@@ -4170,12 +5888,16 @@ ev_run (EV_P_ int flags)
         time_update (EV_A_ waittime + sleeptime);
       }
 
+      STATS (EVPHASE_POLL);
+
       /* queue pending timers and reschedule them */
       timers_reify (EV_A); /* relative timers called last */
 #if EV_PERIODIC_ENABLE
       periodics_reify (EV_A); /* absolute timers called first */
 #endif
 
+      STATS (EVPHASE_TIMERS);
+
 #if EV_IDLE_ENABLE
       /* queue idle watchers unless other events are pending */
       idle_reify (EV_A);
@@ -4188,6 +5910,10 @@ ev_run (EV_P_ int flags)
 #endif
 
       EV_INVOKE_PENDING;
+
+      STATS (EVPHASE_INVOKE);
+
+      PROBE (iteration_done);
     }
   while (ecb_expect_true (
     activecnt
@@ -4226,7 +5952,7 @@ ev_unref (EV_P) EV_NOEXCEPT
 void
 ev_now_update (EV_P) EV_NOEXCEPT
 {
-  time_update (EV_A_ EV_TSTAMP_HUGE);
+  time_update (EV_A_ EV_TS_CONST (EV_TSTAMP_HUGE));
 }
 
 void
@@ -4337,7 +6063,7 @@ ev_io_start (EV_P_ ev_io *w) EV_NOEXCEPT
     return;
 
   assert (("libev: ev_io_start called with negative fd", fd >= 0));
-  assert (("libev: ev_io_start called with illegal event mask", !(w->events & ~(EV__IOFDSET | EV_READ | EV_WRITE))));
+  assert (("libev: ev_io_start called with illegal event mask", !(w->events & ~(EV__IOFDSET | EV_READ | EV_WRITE | EV_EDGE | EV_EXCLUSIVE))));
 
 #if EV_VERIFY >= 2
   assert (("libev: ev_io_start called on watcher with invalid fd", fd_valid (fd)));
@@ -4345,8 +6071,14 @@ ev_io_start (EV_P_ ev_io *w) EV_NOEXCEPT
   EV_FREQUENT_CHECK;
 
   ev_start (EV_A_ (W)w, 1);
-  array_needsize (ANFD, anfds, anfdmax, fd + 1, array_needsize_zerofill);
-  wlist_add (&anfds[fd].head, (WL)w);
+  fd_needsize (EV_A_ fd);
+  wlist_add (&ANFD_head (fd), (WL)w);
+
+#if EV_USE_IOURING
+  /* first watcher for this fd, register it */
+  if (ecb_expect_false (iouring_filemax) && !((WL)w)->next)
+    iouring_file_update (EV_A_ fd, 1);
+#endif
 
   /* common bug, apparently */
   assert (("libev: ev_io_start called with corrupted watcher", ((WL)w)->next != (WL)w));
@@ -4372,9 +6104,15 @@ ev_io_stop (EV_P_ ev_io *w) EV_NOEXCEPT
 #endif
   EV_FREQUENT_CHECK;
 
-  wlist_del (&anfds[w->fd].head, (WL)w);
+  wlist_del (&ANFD_head (w->fd), (WL)w);
   ev_stop (EV_A_ (W)w);
 
+#if EV_USE_IOURING
+  /* last watcher for this fd, unregister it, as the fd might get closed next */
+  if (ecb_expect_false (iouring_filemax) && !ANFD_head (w->fd))
+    iouring_file_update (EV_A_ w->fd, 0);
+#endif
+
   fd_change (EV_A_ w->fd, EV_ANFD_REIFY);
 
   EV_FREQUENT_CHECK;
@@ -4388,23 +6126,80 @@ ev_timer_start (EV_P_ ev_timer *w) EV_NOEXCEPT
     return;
 
   ev_at (w) += mn_now;
+  timer_slack (w);
 
   assert (("libev: ev_timer_start called with negative timer repeat value", w->repeat >= 0.));
 
   EV_FREQUENT_CHECK;
 
-  ++timercnt;
-  ev_start (EV_A_ (W)w, timercnt + HEAP0 - 1);
-  array_needsize (ANHE, timers, timermax, ev_active (w) + 1, array_needsize_noinit);
-  ANHE_w (timers [ev_active (w)]) = (WT)w;
-  ANHE_at_cache (timers [ev_active (w)]);
-  upheap (timers, ev_active (w));
+#if EV_USE_TIMERWHEEL
+  if (ecb_expect_false (twheads))
+    {
+      int n = tw_alloc (EV_A_ (WT)w);
+
+      ++timercnt;
+      ev_start (EV_A_ (W)w, n + 1);
+      tw_link (EV_A_ n);
+    }
+  else
+#endif
+    {
+      ++timercnt;
+      ev_start (EV_A_ (W)w, timercnt + HEAP0 - 1);
+      array_needsize (ANHE, timers, timermax, ev_active (w) + 1, array_needsize_noinit);
+      ANHE_w (timers [ev_active (w)]) = (WT)w;
+      ANHE_at_cache (timers [ev_active (w)]);
+      upheap (timers, ev_active (w));
+    }
 
   EV_FREQUENT_CHECK;
 
   /*assert (("libev: internal timer heap corruption", timers [ev_active (w)] == (WT)w));*/
 }
 
+void
+ev_timer_start_many (EV_P_ ev_timer **w, int count) EV_NOEXCEPT
+{
+  int i, old = timercnt;
+
+#if EV_USE_TIMERWHEEL
+  /* the wheel has no heap to rebuild, so nothing is gained by batching */
+  if (ecb_expect_false (twheads))
+    {
+      for (i = 0; i < count; ++i)
+        ev_timer_start (EV_A_ w [i]);
+
+      return;
+    }
+#endif
+
+  EV_FREQUENT_CHECK;
+
+  array_needsize (ANHE, timers, timermax, timercnt + count + HEAP0, array_needsize_noinit);
+
+  for (i = 0; i < count; ++i)
+    {
+      ev_timer *t = w [i];
+
+      if (ecb_expect_false (ev_is_active (t)))
+        continue;
+
+      ev_at (t) += mn_now;
+      timer_slack (t);
+
+      assert (("libev: ev_timer_start_many called with negative timer repeat value", t->repeat >= 0.));
+
+      ++timercnt;
+      ev_start (EV_A_ (W)t, timercnt + HEAP0 - 1);
+      ANHE_w (timers [ev_active (t)]) = (WT)t;
+      ANHE_at_cache (timers [ev_active (t)]);
+    }
+
+  heap_append (timers, timercnt, old);
+
+  EV_FREQUENT_CHECK;
+}
+
 ecb_noinline
 void
 ev_timer_stop (EV_P_ ev_timer *w) EV_NOEXCEPT
@@ -4418,14 +6213,30 @@ ev_timer_stop (EV_P_ ev_timer *w) EV_NOEXCEPT
   {
     int active = ev_active (w);
 
-    assert (("libev: internal timer heap corruption", ANHE_w (timers [active]) == (WT)w));
+#if EV_USE_TIMERWHEEL
+    if (ecb_expect_false (twheads))
+      {
+        assert (("libev: internal timer wheel corruption", twnodes [active - 1].w == (WT)w));
 
-    --timercnt;
+        /* expired timers are not linked anymore */
+        if (twnodes [active - 1].slot >= 0)
+          tw_unlink (EV_A_ active - 1);
 
-    if (ecb_expect_true (active < timercnt + HEAP0))
+        tw_free (EV_A_ active - 1);
+        --timercnt;
+      }
+    else
+#endif
       {
-        timers [active] = timers [timercnt + HEAP0];
-        adjustheap (timers, timercnt, active);
+        assert (("libev: internal timer heap corruption", ANHE_w (timers [active]) == (WT)w));
+
+        --timercnt;
+
+        if (ecb_expect_true (active < timercnt + HEAP0))
+          {
+            timers [active] = timers [timercnt + HEAP0];
+            adjustheap (timers, timercnt, active);
+          }
       }
   }
 
@@ -4449,8 +6260,20 @@ ev_timer_again (EV_P_ ev_timer *w) EV_NOEXCEPT
       if (w->repeat)
         {
           ev_at (w) = mn_now + w->repeat;
-          ANHE_at_cache (timers [ev_active (w)]);
-          adjustheap (timers, timercnt, ev_active (w));
+          timer_slack (w);
+
+#if EV_USE_TIMERWHEEL
+          if (ecb_expect_false (twheads))
+            {
+              tw_unlink (EV_A_ ev_active (w) - 1);
+              tw_link (EV_A_ ev_active (w) - 1);
+            }
+          else
+#endif
+            {
+              ANHE_at_cache (timers [ev_active (w)]);
+              adjustheap (timers, timercnt, ev_active (w));
+            }
         }
       else
         ev_timer_stop (EV_A_ w);
@@ -4471,18 +6294,10 @@ ev_timer_remaining (EV_P_ ev_timer *w) EV_NOEXCEPT
 }
 
 #if EV_PERIODIC_ENABLE
-ecb_noinline
-void
-ev_periodic_start (EV_P_ ev_periodic *w) EV_NOEXCEPT
+/* calculate the first trigger time of a periodic that is about to be started */
+inline_size void
+periodic_start_at (EV_P_ ev_periodic *w)
 {
-  if (ecb_expect_false (ev_is_active (w)))
-    return;
-
-#if EV_USE_TIMERFD
-  if (timerfd == -2)
-    evtimerfd_init (EV_A);
-#endif
-
   if (w->reschedule_cb)
     ev_at (w) = w->reschedule_cb (w, ev_rt_now);
   else if (w->interval)
@@ -4492,6 +6307,21 @@ ev_periodic_start (EV_P_ ev_periodic *w) EV_NOEXCEPT
     }
   else
     ev_at (w) = w->offset;
+}
+
+ecb_noinline
+void
+ev_periodic_start (EV_P_ ev_periodic *w) EV_NOEXCEPT
+{
+  if (ecb_expect_false (ev_is_active (w)))
+    return;
+
+#if EV_USE_TIMERFD
+  if (timerfd == -2)
+    evtimerfd_init (EV_A);
+#endif
+
+  periodic_start_at (EV_A_ w);
 
   EV_FREQUENT_CHECK;
 
@@ -4507,6 +6337,40 @@ ev_periodic_start (EV_P_ ev_periodic *w) EV_NOEXCEPT
   /*assert (("libev: internal periodic heap corruption", ANHE_w (periodics [ev_active (w)]) == (WT)w));*/
 }
 
+void
+ev_periodic_start_many (EV_P_ ev_periodic **w, int count) EV_NOEXCEPT
+{
+  int i, old = periodiccnt;
+
+#if EV_USE_TIMERFD
+  if (timerfd == -2)
+    evtimerfd_init (EV_A);
+#endif
+
+  EV_FREQUENT_CHECK;
+
+  array_needsize (ANHE, periodics, periodicmax, periodiccnt + count + HEAP0, array_needsize_noinit);
+
+  for (i = 0; i < count; ++i)
+    {
+      ev_periodic *p = w [i];
+
+      if (ecb_expect_false (ev_is_active (p)))
+        continue;
+
+      periodic_start_at (EV_A_ p);
+
+      ++periodiccnt;
+      ev_start (EV_A_ (W)p, periodiccnt + HEAP0 - 1);
+      ANHE_w (periodics [ev_active (p)]) = (WT)p;
+      ANHE_at_cache (periodics [ev_active (p)]);
+    }
+
+  heap_append (periodics, periodiccnt, old);
+
+  EV_FREQUENT_CHECK;
+}
+
 ecb_noinline
 void
 ev_periodic_stop (EV_P_ ev_periodic *w) EV_NOEXCEPT
@@ -4747,7 +6611,7 @@ infy_add (EV_P_ ev_stat *w)
       /* also do poll on <2.6.25, but with normal frequency */
 
       if (!fs_2625)
-        w->timer.repeat = w->interval ? w->interval : DEF_STAT_INTERVAL;
+        w->timer.repeat = w->interval ? w->interval : EV_TS_CONST (DEF_STAT_INTERVAL);
       else if (!statfs (w->path, &sfs)
                && (sfs.f_type == 0x1373 /* devfs */
                    || sfs.f_type == 0x4006 /* fat */
@@ -4763,12 +6627,12 @@ infy_add (EV_P_ ev_stat *w)
                    || sfs.f_type == 0x58465342 /* xfs */))
         w->timer.repeat = 0.; /* filesystem is local, kernel new enough */
       else
-        w->timer.repeat = w->interval ? w->interval : NFS_STAT_INTERVAL; /* remote, use reduced frequency */
+        w->timer.repeat = w->interval ? w->interval : EV_TS_CONST (NFS_STAT_INTERVAL); /* remote, use reduced frequency */
     }
   else
     {
       /* can't use inotify, continue to stat */
-      w->timer.repeat = w->interval ? w->interval : DEF_STAT_INTERVAL;
+      w->timer.repeat = w->interval ? w->interval : EV_TS_CONST (DEF_STAT_INTERVAL);
 
       /* if path is not there, monitor some parent directory for speedup hints */
       /* note that exceeding the hardcoded path limit is not a correctness issue, */
@@ -4952,7 +6816,7 @@ infy_fork (EV_P)
             infy_add (EV_A_ w); /* re-add, no matter what */
           else
             {
-              w->timer.repeat = w->interval ? w->interval : DEF_STAT_INTERVAL;
+              w->timer.repeat = w->interval ? w->interval : EV_TS_CONST (DEF_STAT_INTERVAL);
               if (ev_is_active (&w->timer)) ev_ref (EV_A);
               ev_timer_again (EV_A_ &w->timer);
               if (ev_is_active (&w->timer)) ev_unref (EV_A);
@@ -5027,10 +6891,10 @@ ev_stat_start (EV_P_ ev_stat *w) EV_NOEXCEPT
 
   ev_stat_stat (EV_A_ w);
 
-  if (w->interval < MIN_STAT_INTERVAL && w->interval)
-    w->interval = MIN_STAT_INTERVAL;
+  if (w->interval < EV_TS_CONST (MIN_STAT_INTERVAL) && w->interval)
+    w->interval = EV_TS_CONST (MIN_STAT_INTERVAL);
 
-  ev_timer_init (&w->timer, stat_timer_cb, 0., w->interval ? w->interval : DEF_STAT_INTERVAL);
+  ev_timer_init (&w->timer, stat_timer_cb, 0., w->interval ? w->interval : EV_TS_CONST (DEF_STAT_INTERVAL));
   ev_set_priority (&w->timer, ev_priority (w));
 
 #if EV_USE_INOTIFY
@@ -5203,6 +7067,7 @@ ecb_noinline
 void
 ev_embed_sweep (EV_P_ ev_embed *w) EV_NOEXCEPT
 {
+  PROBE2 (embed_sweep, (void *)w, (void *)w->other);
   ev_run (w->other, EVRUN_NOWAIT);
 }
 
@@ -5211,6 +7076,8 @@ embed_io_cb (EV_P_ ev_io *io, int revents)
 {
   ev_embed *w = (ev_embed *)(((char *)io) - offsetof (ev_embed, io));
 
+  PROBE2 (embed_sweep, (void *)w, (void *)w->other);
+
   if (ev_cb (w))
     ev_feed_event (EV_A_ (W)w, EV_EMBED);
   else
@@ -5239,6 +7106,8 @@ embed_fork_cb (EV_P_ ev_fork *fork_w, int revents)
 {
   ev_embed *w = (ev_embed *)(((char *)fork_w) - offsetof (ev_embed, fork));
 
+  PROBE2 (embed_fork, (void *)w, (void *)w->other);
+
   ev_embed_stop (EV_A_ w);
 
   {
@@ -5400,7 +7269,14 @@ ev_async_start (EV_P_ ev_async *w) EV_NOEXCEPT
   if (ecb_expect_false (ev_is_active (w)))
     return;
 
+#if EV_ATOMIC_OPS
+  /* forget earlier sends, but a sender about to push the watcher */
+  /* still owns the flag, and pipecb clears it later */
+  if (w->sent && sent_remove ((W *)&async_sent, (W)w, offsetof (ev_async, sent_next)))
+    w->sent = 0;
+#else
   w->sent = 0;
+#endif
 
   evpipe_init (EV_A);
 
@@ -5422,6 +7298,13 @@ ev_async_stop (EV_P_ ev_async *w) EV_NOEXCEPT
 
   EV_FREQUENT_CHECK;
 
+#if EV_ATOMIC_OPS
+  /* the watcher might be freed after stopping it, unless other threads */
+  /* still send to it, in which case pipecb skips and unflags it later */
+  if (w->sent && sent_remove ((W *)&async_sent, (W)w, offsetof (ev_async, sent_next)))
+    w->sent = 0;
+#endif
+
   {
     int active = ev_active (w);
 
@@ -5437,11 +7320,366 @@ ev_async_stop (EV_P_ ev_async *w) EV_NOEXCEPT
 void
 ev_async_send (EV_P_ ev_async *w) EV_NOEXCEPT
 {
+#if EV_ATOMIC_OPS
+  /* only the first send until the loop notices queues the watcher */
+  if (!ev_atomic_xchg_int (&w->sent, 1))
+    sent_push ((W *)&async_sent, (W)w, offsetof (ev_async, sent_next));
+#else
   w->sent = 1;
+#endif
   evpipe_write (EV_A_ &async_pending);
 }
 #endif
 
+#if EV_CHANNEL_ENABLE
+inline_speed void
+channel_wake (EV_P_ ev_channel *w)
+{
+  if (!ev_atomic_xchg_int (&w->sent, 1))
+    sent_push ((W *)&channel_sent, (W)w, offsetof (ev_channel, sent_next));
+
+  evpipe_write (EV_A_ &channel_pending);
+}
+
+void
+ev_channel_start (EV_P_ ev_channel *w) EV_NOEXCEPT
+{
+  if (ecb_expect_false (ev_is_active (w)))
+    return;
+
+  evpipe_init (EV_A);
+
+  EV_FREQUENT_CHECK;
+
+  ev_start (EV_A_ (W)w, ++channelcnt);
+  array_needsize (ev_channel *, channels, channelmax, channelcnt, array_needsize_noinit);
+  channels [channelcnt - 1] = w;
+
+  /* messages might have been sent before the watcher was started */
+  if (w->queue)
+    channel_wake (EV_A_ w);
+
+  EV_FREQUENT_CHECK;
+}
+
+void
+ev_channel_stop (EV_P_ ev_channel *w) EV_NOEXCEPT
+{
+  clear_pending (EV_A_ (W)w);
+
+  /* the watcher might be freed after stopping it, unless other threads */
+  /* still send to it, in which case pipecb skips and unflags it later */
+  if (w->sent && sent_remove ((W *)&channel_sent, (W)w, offsetof (ev_channel, sent_next)))
+    w->sent = 0;
+
+  if (ecb_expect_false (!ev_is_active (w)))
+    return;
+
+  EV_FREQUENT_CHECK;
+
+  {
+    int active = ev_active (w);
+
+    channels [active - 1] = channels [--channelcnt];
+    ev_active (channels [active - 1]) = active;
+  }
+
+  ev_stop (EV_A_ (W)w);
+
+  EV_FREQUENT_CHECK;
+}
+
+int
+ev_channel_send (EV_P_ ev_channel *w, ev_channel_msg *msg) EV_NOEXCEPT
+{
+  ev_channel_msg *head, *prev;
+
+  if (w->limit && ev_atomic_add_int (&w->count, 1) >= (int)w->limit)
+    {
+      ev_atomic_add_int (&w->count, -1);
+      return 0;
+    }
+
+  for (head = w->queue; ; head = prev)
+    {
+      msg->next = head;
+
+      if ((prev = (ev_channel_msg *)ev_atomic_cas_ptr (&w->queue, head, msg)) == head)
+        break;
+    }
+
+  /* only a message sent to an empty queue needs to wake up the loop, */
+  /* as the loop empties the queue only after it was woken up */
+  if (!head)
+    channel_wake (EV_A_ w);
+
+  return 1;
+}
+
+ev_channel_msg *
+ev_channel_recv (EV_P_ ev_channel *w) EV_NOEXCEPT
+{
+  ev_channel_msg *msgs;
+
+  channel_drain (w);
+
+  msgs = w->msgs;
+  w->msgs = 0;
+
+  return msgs;
+}
+#endif
+
+#if EV_URING_ENABLE
+/* perform the operation synchronously, for the emulation */
+/* returns the result in io_uring style, i.e. -errno on error */
+static int
+uring_syscall (EV_P_ ev_uring *w)
+{
+  long res;
+
+  switch (w->op)
+    {
+      case EV_URING_READ:
+        res = w->off < 0 ? read (w->fd, w->buf, w->len) : pread (w->fd, w->buf, w->len, w->off);
+        break;
+
+      case EV_URING_WRITE:
+        res = w->off < 0 ? write (w->fd, w->buf, w->len) : pwrite (w->fd, w->buf, w->len, w->off);
+        break;
+
+      case EV_URING_ACCEPT:
+        {
+          socklen_t salen = w->len;
+
+          res = accept (w->fd, (struct sockaddr *)w->buf, w->buf ? &salen : 0);
+
+          if (res >= 0)
+            {
+              w->len = salen;
+
+              /* accept4 is not portable, so emulate the two flags that matter */
+#ifdef SOCK_CLOEXEC
+              if (w->flags & SOCK_CLOEXEC)
+                fcntl (res, F_SETFD, FD_CLOEXEC);
+#endif
+#ifdef SOCK_NONBLOCK
+              if (w->flags & SOCK_NONBLOCK)
+                fcntl (res, F_SETFL, O_NONBLOCK);
+#endif
+            }
+        }
+        break;
+
+      /* several watchers might race for the same data, so never block */
+      case EV_URING_RECV:
+        res = recv (w->fd, w->buf, w->len, w->flags | MSG_DONTWAIT);
+        break;
+
+      case EV_URING_SEND:
+        res = send (w->fd, w->buf, w->len, w->flags | MSG_DONTWAIT);
+        break;
+
+      case EV_URING_RECVMSG:
+        res = recvmsg (w->fd, (struct msghdr *)w->buf, w->flags | MSG_DONTWAIT);
+        break;
+
+      case EV_URING_SENDMSG:
+        res = sendmsg (w->fd, (struct msghdr *)w->buf, w->flags | MSG_DONTWAIT);
+        break;
+
+      default:
+        errno = EINVAL;
+        res = -1;
+        break;
+    }
+
+  return res < 0 ? -errno : res;
+}
+
+/* the buffer now belongs to the user, until ev_uring_release */
+static void
+uring_buf_take (EV_P_ ev_uring *w, unsigned int bid)
+{
+  uring_bufout [bid] = 1;
+  w->buf = uring_bufs + (size_t)bid * uring_bufsize;
+  w->len = uring_bufsize;
+}
+
+/* the kernel no longer owns any buffers, so collect the free ones */
+static void
+uring_buf_reset (EV_P)
+{
+  unsigned int bid;
+
+  uring_buffreecnt = 0;
+
+  for (bid = uring_bufcnt; bid--; )
+    if (!uring_bufout [bid])
+      uring_buffree [uring_buffreecnt++] = bid;
+}
+
+/* the operation has completed, one way or another */
+static void
+uring_done (EV_P_ ev_uring *w, int res)
+{
+  w->res = res;
+  ev_stop (EV_A_ (W)w);
+  ev_feed_event (EV_A_ (W)w, EV_URING);
+}
+
+/* readiness-based emulation: wait for the fd, then do the syscall */
+static void
+uring_io_cb (EV_P_ ev_io *iow, int revents)
+{
+  ev_uring *w = (ev_uring *)(((char *)iow) - offsetof (ev_uring, io));
+  int res;
+
+  if (uring_pooled (EV_A_ w))
+    {
+      /* only pick a buffer once there is data, so idle fds hold none */
+      if (uring_buffreecnt)
+        {
+          unsigned int bid = uring_buffree [--uring_buffreecnt];
+
+          w->buf = uring_bufs + (size_t)bid * uring_bufsize;
+          w->len = uring_bufsize;
+          res    = uring_syscall (EV_A_ w);
+
+          if (res >= 0)
+            uring_buf_take (EV_A_ w, bid);
+          else
+            {
+              w->buf = 0;
+              uring_buffree [uring_buffreecnt++] = bid;
+            }
+        }
+      else
+        res = -ENOBUFS;
+    }
+  else
+    res = uring_syscall (EV_A_ w);
+
+  if (res == -EAGAIN || res == -EWOULDBLOCK || res == -EINTR)
+    return; /* spurious readiness notification, wait again */
+
+  ev_ref (EV_A);
+  ev_io_stop (EV_A_ iow);
+  uring_done (EV_A_ w, res);
+}
+
+static void
+uring_emulate (EV_P_ ev_uring *w)
+{
+  int writing = w->op == EV_URING_WRITE || w->op == EV_URING_SEND || w->op == EV_URING_SENDMSG;
+
+  ev_io_set (&w->io, w->fd, writing ? EV_WRITE : EV_READ);
+  ev_set_priority (&w->io, ev_priority (w));
+  ev_io_start (EV_A_ &w->io);
+  ev_unref (EV_A);
+}
+
+void
+ev_uring_start (EV_P_ ev_uring *w) EV_NOEXCEPT
+{
+  if (ecb_expect_false (ev_is_active (w)))
+    return;
+
+  assert (("libev: ev_uring_start called with illegal operation", w->op >= EV_URING_READ && w->op <= EV_URING_SENDMSG));
+  assert (("libev: ev_uring_start called with negative fd", w->fd >= 0));
+  assert (("libev: ev_uring_start called while the kernel still owns the watcher", !ev_uring_busy (w)));
+
+  EV_FREQUENT_CHECK;
+
+  w->res = 0;
+  ev_init (&w->io, uring_io_cb);
+
+#if EV_USE_IOURING
+  /* without a kernel buffer ring, pooled operations are emulated, */
+  /* so they do not tie up a buffer while waiting */
+  if (backend == EVBACKEND_IOURING && (iouring_bufring || !uring_pooled (EV_A_ w)))
+    {
+      int slot = iouring_op_alloc (EV_A_ w);
+
+      ev_start (EV_A_ (W)w, slot + 1);
+      iouring_op_submit (EV_A_ slot);
+    }
+  else
+#endif
+    {
+      ev_start (EV_A_ (W)w, 1);
+      uring_emulate (EV_A_ w);
+    }
+
+  EV_FREQUENT_CHECK;
+}
+
+void
+ev_uring_stop (EV_P_ ev_uring *w) EV_NOEXCEPT
+{
+  clear_pending (EV_A_ (W)w);
+  if (ecb_expect_false (!ev_is_active (w)))
+    return;
+
+  EV_FREQUENT_CHECK;
+
+  if (ev_is_active (&w->io))
+    {
+      ev_ref (EV_A);
+      ev_io_stop (EV_A_ &w->io);
+    }
+#if EV_USE_IOURING
+  else
+    iouring_op_cancel (EV_A_ ev_active (w) - 1);
+#endif
+
+  ev_stop (EV_A_ (W)w);
+
+  EV_FREQUENT_CHECK;
+}
+
+void
+ev_uring_buffers (EV_P_ unsigned int count, unsigned int size) EV_NOEXCEPT
+{
+  assert (("libev: ev_uring_buffers must only be called once per loop", !uring_bufcnt));
+  assert (("libev: ev_uring_buffers count must be a power of two between 1 and 32768", count && count <= 32768 && !(count & (count - 1))));
+  assert (("libev: ev_uring_buffers size must not be zero", size));
+
+  uring_bufs    = (char *)ev_malloc ((size_t)count * size);
+  uring_bufout  = (unsigned char *)ev_malloc (count);
+  uring_buffree = (unsigned short *)ev_malloc (count * sizeof (unsigned short));
+  uring_bufsize = size;
+  uring_bufcnt  = count;
+
+  memset (uring_bufout, 0, count);
+  uring_buf_reset (EV_A);
+
+#if EV_USE_IOURING
+  /* hand the buffers to the kernel, if it can select them itself */
+  if (backend == EVBACKEND_IOURING && iouring_bufring_init (EV_A))
+    uring_buffreecnt = 0;
+#endif
+}
+
+void
+ev_uring_release (EV_P_ void *buf) EV_NOEXCEPT
+{
+  unsigned int bid = ((char *)buf - uring_bufs) / uring_bufsize;
+
+  assert (("libev: ev_uring_release called with a buffer not from the pool", (char *)buf >= uring_bufs && bid < uring_bufcnt));
+  assert (("libev: ev_uring_release called with a buffer that was not handed out", uring_bufout [bid]));
+
+  uring_bufout [bid] = 0;
+
+#if EV_USE_IOURING
+  if (iouring_bufring)
+    iouring_buf_provide (EV_A_ bid);
+  else
+#endif
+    uring_buffree [uring_buffreecnt++] = bid;
+}
+#endif
+
 /*****************************************************************************/
 
 struct ev_once
@@ -5516,7 +7754,7 @@ ev_walk (EV_P_ int types, void (*cb)(EV_P_ int type, void *w)) EV_NOEXCEPT
 
   if (types & (EV_IO | EV_EMBED))
     for (i = 0; i < anfdmax; ++i)
-      for (wl = anfds [i].head; wl; )
+      for (wl = ANFD_head (i); wl; )
         {
           wn = wl->next;
 
@@ -5532,6 +7770,11 @@ ev_walk (EV_P_ int types, void (*cb)(EV_P_ int type, void *w)) EV_NOEXCEPT
           if (ev_cb ((ev_io *)wl) == infy_cb)
             ;
           else
+#endif
+#if EV_URING_ENABLE
+          if (ev_cb ((ev_io *)wl) == uring_io_cb)
+            ;
+          else
 #endif
           if ((ev_io *)wl != &pipe_w)
             if (types & EV_IO)
@@ -5541,18 +7784,47 @@ ev_walk (EV_P_ int types, void (*cb)(EV_P_ int type, void *w)) EV_NOEXCEPT
         }
 
   if (types & (EV_TIMER | EV_STAT))
-    for (i = timercnt + HEAP0; i-- > HEAP0; )
-#if EV_STAT_ENABLE
-      /*TODO: timer is not always active*/
-      if (ev_cb ((ev_timer *)ANHE_w (timers [i])) == stat_timer_cb)
+    {
+      int timerlimit = HEAP0;
+
+#if EV_USE_TIMERWHEEL
+      if (twheads)
         {
-          if (types & EV_STAT)
-            cb (EV_A_ EV_STAT, ((char *)ANHE_w (timers [i])) - offsetof (struct ev_stat, timer));
+          i = twnodecnt;
+          timerlimit = 0;
         }
       else
 #endif
-      if (types & EV_TIMER)
-        cb (EV_A_ EV_TIMER, ANHE_w (timers [i]));
+        i = timercnt + HEAP0;
+
+      while (i-- > timerlimit)
+        {
+          WT w;
+
+#if EV_USE_TIMERWHEEL
+          if (twheads)
+            {
+              /* free nodes have no timer */
+              if (!(w = twnodes [i].w))
+                continue;
+            }
+          else
+#endif
+            w = ANHE_w (timers [i]);
+
+#if EV_STAT_ENABLE
+          /*TODO: timer is not always active*/
+          if (ev_cb ((ev_timer *)w) == stat_timer_cb)
+            {
+              if (types & EV_STAT)
+                cb (EV_A_ EV_STAT, ((char *)w) - offsetof (struct ev_stat, timer));
+            }
+          else
+#endif
+          if (types & EV_TIMER)
+            cb (EV_A_ EV_TIMER, w);
+        }
+    }
 
 #if EV_PERIODIC_ENABLE
   if (types & EV_PERIODIC)
@@ -5580,6 +7852,12 @@ ev_walk (EV_P_ int types, void (*cb)(EV_P_ int type, void *w)) EV_NOEXCEPT
       cb (EV_A_ EV_ASYNC, asyncs [i]);
 #endif
 
+#if EV_CHANNEL_ENABLE
+  if (types & EV_CHANNEL)
+    for (i = channelcnt; i--; )
+      cb (EV_A_ EV_CHANNEL, channels [i]);
+#endif
+
 #if EV_PREPARE_ENABLE
   if (types & EV_PREPARE)
     for (i = preparecnt; i--; )
@@ -5621,6 +7899,14 @@ ev_walk (EV_P_ int types, void (*cb)(EV_P_ int type, void *w)) EV_NOEXCEPT
 }
 #endif
 
+#if EV_WORK_ENABLE
+# include "ev_work.c"
+#endif
+
+#if EV_GROUP_ENABLE
+# include "ev_group.c"
+#endif
+
 #if EV_MULTIPLICITY
   #include "ev_wrap.h"
 #endif
@@ -134,14 +134,46 @@ EV_CPP(extern "C" {)
 # define EV_ASYNC_ENABLE EV_FEATURE_WATCHERS
 #endif
 
+#ifndef EV_CHANNEL_ENABLE
+# define EV_CHANNEL_ENABLE EV_FEATURE_WATCHERS
+#endif
+
+#ifndef EV_WORK_ENABLE
+# ifdef _WIN32
+#  define EV_WORK_ENABLE 0
+# else
+#  define EV_WORK_ENABLE EV_FEATURE_WATCHERS
+# endif
+#endif
+
 #ifndef EV_EMBED_ENABLE
 # define EV_EMBED_ENABLE EV_FEATURE_WATCHERS
 #endif
 
+#ifndef EV_URING_ENABLE
+# ifdef _WIN32
+#  define EV_URING_ENABLE 0
+# else
+#  define EV_URING_ENABLE EV_FEATURE_WATCHERS
+# endif
+#endif
+
 #ifndef EV_WALK_ENABLE
 # define EV_WALK_ENABLE 0 /* not yet */
 #endif
 
+#ifndef EV_STATS_ENABLE
+# define EV_STATS_ENABLE EV_FEATURE_API
+#endif
+
+#ifndef EV_GROUP_ENABLE
+# ifdef _WIN32
+#  define EV_GROUP_ENABLE 0
+# else
+#  define EV_GROUP_ENABLE (EV_MULTIPLICITY && EV_FEATURE_API)
+# endif
+#endif
+
 /*****************************************************************************/
 
 #if EV_CHILD_ENABLE && !EV_SIGNAL_ENABLE
@@ -149,8 +181,33 @@ EV_CPP(extern "C" {)
 # define EV_SIGNAL_ENABLE 1
 #endif
 
+#if EV_GROUP_ENABLE && !EV_MULTIPLICITY
+# undef EV_GROUP_ENABLE
+# define EV_GROUP_ENABLE 0
+#endif
+
+#if EV_GROUP_ENABLE && !EV_CHANNEL_ENABLE
+# undef EV_CHANNEL_ENABLE
+# define EV_CHANNEL_ENABLE 1
+#endif
+
 /*****************************************************************************/
 
+#ifndef EV_TSTAMP_INT64
+# define EV_TSTAMP_INT64 0
+#endif
+
+/* with EV_TSTAMP_INT64, all times are integer nanoseconds */
+#if EV_TSTAMP_INT64
+# undef EV_TSTAMP_T
+# define EV_TSTAMP_T long long
+# define EV_TS_FROM_SEC(sec) ev_ts_from_sec (sec)
+# define EV_TS_TO_SEC(ts) ((double)(ts) * 1e-9)
+#else
+# define EV_TS_FROM_SEC(sec) (sec)
+# define EV_TS_TO_SEC(ts) (ts)
+#endif
+
 #ifndef EV_TSTAMP_T
 # define EV_TSTAMP_T double
 #endif
@@ -201,6 +258,23 @@ struct ev_loop;
 # define EV_INLINE static
 #endif
 
+#if EV_TSTAMP_INT64
+/* round to the nearest nanosecond, as e.g. 0.3 * 1e9 is slightly below 300000000 */
+EV_INLINE ev_tstamp
+ev_ts_from_sec (double sec)
+{
+  return (ev_tstamp)(sec * 1e9 + (sec < 0. ? -.5 : .5));
+}
+
+/* the time representation is part of the ABI, so the functions that every */
+/* program needs get different names, and mixing code built with and */
+/* without EV_TSTAMP_INT64 fails to link, instead of misinterpreting times */
+# define ev_default_loop ev_default_loop_tsi64
+# define ev_loop_new     ev_loop_new_tsi64
+# define ev_time         ev_time_tsi64
+# define ev_sleep        ev_sleep_tsi64
+#endif
+
 #ifdef EV_API_STATIC
 # define EV_API_DECL static
 #else
@@ -223,6 +297,8 @@ enum {
   EV_NONE     =            0x00, /* no events */
   EV_READ     =            0x01, /* ev_io detected read will not block */
   EV_WRITE    =            0x02, /* ev_io detected write will not block */
+  EV_EXCLUSIVE =           0x20, /* ev_io shares the fd with other loops, wake only one of them */
+  EV_EDGE     =            0x40, /* ev_io may be edge-triggered, if the backend supports it */
   EV__IOFDSET =            0x80, /* internal use only */
   EV_IO       =         EV_READ, /* alias for type-detection */
   EV_TIMER    =      0x00000100, /* timer timed out */
@@ -240,6 +316,9 @@ enum {
   EV_FORK     =      0x00020000, /* event loop resumed in child */
   EV_CLEANUP  =      0x00040000, /* event loop resumed in child */
   EV_ASYNC    =      0x00080000, /* async intra-loop signal */
+  EV_URING    =      0x00100000, /* submitted i/o operation completed */
+  EV_CHANNEL  =      0x00200000, /* messages were sent to a channel */
+  EV_WORK     =      0x00400000, /* work function has been run by the pool */
   EV_CUSTOM   =      0x01000000, /* for use by user code */
   EV_ERROR    = (int)0x80000000  /* sent when an error occurs */
 };
@@ -274,19 +353,27 @@ enum {
  *           or simply 1 for watchers that aren't in some array.
  * pending is either 0, in which case the watcher isn't,
  *           or the array index + 1 in the pendings array.
+ * wflags holds optional per-watcher settings, EV__WF_*, and is cleared
+ *           by ev_init, so that members that are not set by ev_init
+ *           are only used once they have been set explicitly.
  */
 
 #if EV_MINPRI == EV_MAXPRI
 # define EV_DECL_PRIORITY
 #elif !defined (EV_DECL_PRIORITY)
-# define EV_DECL_PRIORITY int priority;
+# define EV_DECL_PRIORITY short priority;
 #endif
 
+/* wflags bits, internal use only */
+#define EV__WF_SLACK 0x0001 /* the ev_timer slack member has been set */
+#define EV__WF_BUSY  0x0002 /* the kernel still owns the buffer of a stopped ev_uring */
+
 /* shared by all watchers */
 #define EV_WATCHER(type)			\
   int active; /* private */			\
   int pending; /* private */			\
   EV_DECL_PRIORITY /* private */		\
+  unsigned short wflags; /* private */		\
   EV_COMMON /* rw */				\
   EV_CB_DECLARE (type) /* private */
 
@@ -333,6 +420,7 @@ typedef struct ev_timer
   EV_WATCHER_TIME (ev_timer)
 
   ev_tstamp repeat; /* rw */
+  ev_tstamp slack;  /* rw, may expire this much later, to share a wakeup, set with ev_timer_set_slack */
 } ev_timer;
 
 /* invoked at some specific time, possibly repeating at regular intervals (based on UTC) */
@@ -459,11 +547,94 @@ typedef struct ev_async
   EV_WATCHER (ev_async)
 
   EV_ATOMIC_T sent; /* private */
+  struct ev_async *sent_next; /* private */
 } ev_async;
 
 # define ev_async_pending(w) (+(w)->sent)
 #endif
 
+#if EV_CHANNEL_ENABLE
+/* a message sent through an ev_channel, embed it at the start of your own message type */
+typedef struct ev_channel_msg
+{
+  struct ev_channel_msg *next;
+} ev_channel_msg;
+
+/* invoked when somebody calls ev_channel_send on the watcher, from any thread */
+/* revent EV_CHANNEL */
+typedef struct ev_channel
+{
+  EV_WATCHER (ev_channel)
+
+  unsigned int limit;           /* ro, maximum number of messages not yet received by the loop, 0 for unlimited */
+
+  struct ev_channel_msg *queue; /* private, messages sent, newest first */
+  struct ev_channel_msg *msgs;  /* private, messages received by the loop, oldest first */
+  struct ev_channel_msg *last;  /* private */
+  int count;                    /* private */
+  EV_ATOMIC_T sent;             /* private */
+  struct ev_channel *sent_next; /* private */
+} ev_channel;
+#endif
+
+#if EV_WORK_ENABLE
+/* invoked after the work function has been run by a thread of the work pool */
+/* revent EV_WORK */
+typedef struct ev_work
+{
+  EV_WATCHER (ev_work)
+
+  void (*work)(struct ev_work *w); /* ro, run in a pool thread, must not touch the loop */
+
+#if EV_MULTIPLICITY
+  struct ev_loop *loop;            /* private */
+#endif
+  struct ev_work *done_next;       /* private */
+  EV_ATOMIC_T state;               /* private */
+  unsigned int worker;             /* private */
+} ev_work;
+
+/* per-worker statistics, see ev_work_pool_stats */
+typedef struct ev_work_stats
+{
+  unsigned long executed;          /* work functions run by this worker */
+  unsigned long stolen;            /* of which were taken from another worker's deque */
+  unsigned int queued;             /* currently waiting in this worker's deque */
+} ev_work_stats;
+#endif
+
+#if EV_URING_ENABLE
+/* operations for ev_uring watchers */
+enum {
+  EV_URING_READ    = 1, /* read/pread (fd, buf, len, off) */
+  EV_URING_WRITE   = 2, /* write/pwrite (fd, buf, len, off) */
+  EV_URING_ACCEPT  = 3, /* accept4 (fd, (struct sockaddr *)buf, &len, flags) */
+  EV_URING_RECV    = 4, /* recv (fd, buf, len, flags) */
+  EV_URING_SEND    = 5, /* send (fd, buf, len, flags) */
+  EV_URING_RECVMSG = 6, /* recvmsg (fd, (struct msghdr *)buf, flags) */
+  EV_URING_SENDMSG = 7  /* sendmsg (fd, (struct msghdr *)buf, flags) */
+};
+
+/* invoked when the submitted i/o operation has completed */
+/* native on io_uring, emulated via an ev_io watcher on other backends */
+/* revent EV_URING */
+typedef struct ev_uring
+{
+  EV_WATCHER (ev_uring)
+
+  int op;           /* ro */
+  int fd;           /* ro */
+  void *buf;        /* buffer, struct sockaddr * (accept) or struct msghdr * (recvmsg, sendmsg) */
+                    /* if null for read/recv, set to a pool buffer on completion, see ev_uring_buffers */
+  unsigned int len; /* ro, buffer length, or in/out address length (accept) */
+  int flags;        /* ro, msg flags, accept4 flags or rw flags */
+  long long off;    /* ro, file offset for read/write, -1 means current position */
+  int res;          /* ro, bytes transferred, new fd (accept) or -errno */
+
+  ev_io io;         /* private */
+} ev_uring;
+#endif
+
 /* the presence of this union forces similar struct layout */
 union ev_any_watcher
 {
@@ -495,8 +666,56 @@ union ev_any_watcher
 #if EV_ASYNC_ENABLE
   struct ev_async async;
 #endif
+#if EV_CHANNEL_ENABLE
+  struct ev_channel channel;
+#endif
+#if EV_WORK_ENABLE
+  struct ev_work work;
+#endif
+#if EV_URING_ENABLE
+  struct ev_uring uring;
+#endif
 };
 
+#if EV_STATS_ENABLE
+/* the phases of a loop iteration measured by ev_set_stats */
+enum {
+  EVPHASE_FD_REIFY, /* applying fd changes to the kernel */
+  EVPHASE_POLL,     /* waiting for and collecting events */
+  EVPHASE_TIMERS,   /* expiring timers and periodics */
+  EVPHASE_INVOKE,   /* invoking the pending callbacks, including idle and check watchers */
+  EVPHASE_COUNT
+};
+
+/* latency histogram buckets: exact up to 16ns, then 8 per power of two, up to ~1000s */
+#define EV_STATS_BUCKETS 312
+
+typedef struct ev_stats
+{
+  unsigned long iterations;          /* number of loop iterations measured */
+  unsigned long events;              /* watchers made pending by polling */
+  unsigned long empty;               /* iterations in which neither polling nor timers produced events */
+  unsigned long pending [EV_MAXPRI - EV_MINPRI + 1]; /* pending watchers per priority, summed over all iterations */
+  unsigned int last_events;          /* watchers made pending by the last poll */
+  ev_tstamp last [EVPHASE_COUNT];    /* duration of each phase in the last iteration */
+  ev_tstamp time [EVPHASE_COUNT];    /* total duration of each phase */
+  unsigned int hist [EVPHASE_COUNT][EV_STATS_BUCKETS]; /* phase durations, see ev_stats_quantile */
+  ev_tstamp clock_drift;             /* largest difference between the loop clock and the monotonic clock */
+  unsigned long clock_resyncs;       /* number of times the loop clock was compared against it */
+} ev_stats;
+
+/* callback latencies, see ev_set_cb_profile */
+typedef struct ev_cb_profile
+{
+  void *cb;                          /* the callback, or 0 for the totals of a watcher type */
+  int type;                          /* the watcher type (EV_IO, EV_TIMER...), EV_CUSTOM if unknown */
+  unsigned long count;               /* number of invocations */
+  ev_tstamp time;                    /* total time spent in the callback */
+  ev_tstamp max;                     /* longest invocation */
+  unsigned int hist [EV_STATS_BUCKETS]; /* invocation durations, see ev_cb_profile_quantile */
+} ev_cb_profile;
+#endif
+
 /* flag bits for ev_default_loop and ev_loop_new */
 enum {
   /* the default */
@@ -504,6 +723,9 @@ enum {
   /* flag bits */
   EVFLAG_NOENV      = 0x01000000U, /* do NOT consult environment */
   EVFLAG_FORKCHECK  = 0x02000000U, /* check for a fork in each iteration */
+  EVFLAG_TIMERWHEEL = 0x04000000U, /* keep ev_timers in a timing wheel instead of a heap */
+  EVFLAG_COARSECLOCK = 0x08000000U, /* use the cheaper, tick-resolution monotonic clock */
+  EVFLAG_TSCCLOCK   = 0x10000000U, /* use the invariant tsc, calibrated against the monotonic clock */
   /* debugging/feature disable */
   EVFLAG_NOINOTIFY  = 0x00100000U, /* do not attempt to use inotify */
 #if EV_COMPAT3
@@ -511,7 +733,12 @@ enum {
 #endif
   EVFLAG_SIGNALFD   = 0x00200000U, /* attempt to use signalfd */
   EVFLAG_NOSIGMASK  = 0x00400000U, /* avoid modifying the signal mask */
-  EVFLAG_NOTIMERFD  = 0x00800000U  /* avoid creating a timerfd */
+  EVFLAG_NOTIMERFD  = 0x00800000U, /* avoid creating a timerfd */
+  /* backend-specific */
+  EVFLAG_IOURING_FILES  = 0x00010000U, /* io_uring: register watched fds with the kernel */
+  EVFLAG_IOURING_SQPOLL = 0x00020000U, /* io_uring: let a kernel thread poll the submission queue */
+  EVFLAG_EPOLL_BATCH    = 0x00040000U, /* epoll: batch epoll_ctl calls, via io_uring if possible */
+  EVFLAG_BUSYPOLL       = 0x00080000U  /* epoll: spin for events for a while before blocking */
 };
 
 /* method bits to be ored together */
@@ -553,6 +780,20 @@ EV_API_DECL void ev_set_allocator (void *(*cb)(void *ptr, long size) EV_NOEXCEPT
  */
 EV_API_DECL void ev_set_syserr_cb (void (*cb)(const char *msg) EV_NOEXCEPT) EV_NOEXCEPT;
 
+#if EV_STATS_ENABLE
+/* the duration below which the given fraction (0..1) of a phase's durations fall */
+EV_API_DECL ev_tstamp ev_stats_quantile (const ev_stats *stats, int phase, double q) EV_NOEXCEPT;
+EV_API_DECL ev_tstamp ev_cb_profile_quantile (const ev_cb_profile *profile, double q) EV_NOEXCEPT;
+#endif
+
+#if EV_WORK_ENABLE
+/* number of pool threads, 0 (the default) means one per cpu, only effective before the first ev_work_start */
+EV_API_DECL void ev_work_pool_size (unsigned int threads) EV_NOEXCEPT;
+EV_API_DECL unsigned int ev_work_pool_threads (void) EV_NOEXCEPT; /* number of running pool threads */
+/* returns 0 if there is no such worker */
+EV_API_DECL int ev_work_pool_stats (unsigned int worker, ev_work_stats *stats) EV_NOEXCEPT;
+#endif
+
 #if EV_MULTIPLICITY
 
 /* the default loop is the only one that handles signals and child watchers */
@@ -661,10 +902,14 @@ EV_API_DECL void ev_invoke_pending (EV_P); /* invoke all pending watchers */
 # if EV_FEATURE_API
 EV_API_DECL unsigned int ev_iteration (EV_P) EV_NOEXCEPT; /* number of loop iterations */
 EV_API_DECL unsigned int ev_depth     (EV_P) EV_NOEXCEPT; /* #ev_loop enters - #ev_loop leaves */
+EV_API_DECL unsigned int ev_timer_wakeups_saved (EV_P) EV_NOEXCEPT; /* timer expiries that shared a wakeup thanks to their slack */
 EV_API_DECL void         ev_verify    (EV_P) EV_NOEXCEPT; /* abort if loop data corrupted */
 
 EV_API_DECL void ev_set_io_collect_interval (EV_P_ ev_tstamp interval) EV_NOEXCEPT; /* sleep at least this time, default 0 */
 EV_API_DECL void ev_set_timeout_collect_interval (EV_P_ ev_tstamp interval) EV_NOEXCEPT; /* sleep at least this time, default 0 */
+EV_API_DECL void ev_set_busypoll_interval (EV_P_ ev_tstamp interval) EV_NOEXCEPT; /* spin at most this time before blocking */
+EV_API_DECL unsigned int ev_busypoll_spins (EV_P) EV_NOEXCEPT; /* number of times the loop spun before blocking */
+EV_API_DECL unsigned int ev_busypoll_hits  (EV_P) EV_NOEXCEPT; /* number of spins that found events */
 
 /* advanced stuff for threading etc. support, see docs */
 EV_API_DECL void ev_set_userdata (EV_P_ void *data) EV_NOEXCEPT;
@@ -683,6 +928,35 @@ EV_API_DECL void ev_suspend (EV_P) EV_NOEXCEPT;
 EV_API_DECL void ev_resume  (EV_P) EV_NOEXCEPT;
 #endif
 
+#if EV_STATS_ENABLE
+EV_API_DECL void ev_set_stats  (EV_P_ int enable) EV_NOEXCEPT; /* start (and reset) or stop collecting statistics */
+EV_API_DECL int  ev_loop_stats (EV_P_ ev_stats *stats) EV_NOEXCEPT; /* returns 0 if not collecting */
+/* start (and reset) or stop timing callbacks, calling slow_cb for those that take at least threshold seconds */
+EV_API_DECL void ev_set_cb_profile (EV_P_ int enable, ev_tstamp threshold, void (*slow_cb)(EV_P_ void *w, int type, int priority, ev_tstamp duration)) EV_NOEXCEPT;
+/* calls cb with the profile of every watcher type and then of every callback seen so far */
+EV_API_DECL void ev_cb_profile_walk (EV_P_ void (*cb)(EV_P_ const ev_cb_profile *profile, void *arg), void *arg);
+#endif
+
+#if EV_GROUP_ENABLE
+/* flag bits for ev_loop_group_new */
+enum {
+  EVGROUP_NOAFFINITY  = 1, /* do not pin the loop threads to cpus */
+  EVGROUP_LEASTLOADED = 2  /* ev_loop_group_pick prefers the least busy loop over round-robin */
+};
+
+/* count loops (0 = one per cpu), each created with flags and run by its own thread */
+typedef struct ev_loop_group ev_loop_group;
+EV_API_DECL ev_loop_group *ev_loop_group_new (unsigned int count, unsigned int flags EV_CPP (= 0), unsigned int gflags EV_CPP (= 0)) EV_NOEXCEPT;
+EV_API_DECL void ev_loop_group_destroy (ev_loop_group *group) EV_NOEXCEPT; /* breaks, joins and destroys all loops */
+EV_API_DECL void ev_loop_group_break   (ev_loop_group *group) EV_NOEXCEPT; /* asks all loops to return from ev_run */
+EV_API_DECL unsigned int ev_loop_group_count (ev_loop_group *group) EV_NOEXCEPT;
+EV_API_DECL struct ev_loop *ev_loop_group_loop (ev_loop_group *group, unsigned int index) EV_NOEXCEPT;
+/* returns the index of the loop that should get the next unit of work */
+EV_API_DECL unsigned int ev_loop_group_pick (ev_loop_group *group) EV_NOEXCEPT;
+/* thread-safe, runs cb (loop, data) in the thread of the given loop */
+EV_API_DECL void ev_loop_group_submit (ev_loop_group *group, unsigned int index, void (*cb)(EV_P_ void *data), void *data) EV_NOEXCEPT;
+#endif
+
 #endif
 
 /* these may evaluate ev multiple times, and the other arguments at most once */
@@ -690,13 +964,15 @@ EV_API_DECL void ev_resume  (EV_P) EV_NOEXCEPT;
 #define ev_init(ev,cb_) do {			\
   ((ev_watcher *)(void *)(ev))->active  =	\
   ((ev_watcher *)(void *)(ev))->pending = 0;	\
+  ((ev_watcher *)(void *)(ev))->wflags  = 0;	\
   ev_set_priority ((ev), 0);			\
   ev_set_cb ((ev), cb_);			\
 } while (0)
 
 #define ev_io_modify(ev,events_)             do { (ev)->events = (ev)->events & EV__IOFDSET | (events_); } while (0)
 #define ev_io_set(ev,fd_,events_)            do { (ev)->fd = (fd_); (ev)->events = (events_) | EV__IOFDSET; } while (0)
-#define ev_timer_set(ev,after_,repeat_)      do { ((ev_watcher_time *)(ev))->at = (after_); (ev)->repeat = (repeat_); } while (0)
+#define ev_timer_set(ev,after_,repeat_)      do { ((ev_watcher_time *)(ev))->at = (after_); (ev)->repeat = (repeat_); (ev)->slack = 0; } while (0)
+#define ev_timer_set_slack(ev,slack_)        do { (ev)->slack = (slack_); (ev)->wflags |= EV__WF_SLACK; } while (0)
 #define ev_periodic_set(ev,ofs_,ival_,rcb_)  do { (ev)->offset = (ofs_); (ev)->interval = (ival_); (ev)->reschedule_cb = (rcb_); } while (0)
 #define ev_signal_set(ev,signum_)            do { (ev)->signum = (signum_); } while (0)
 #define ev_child_set(ev,pid_,trace_)         do { (ev)->pid = (pid_); (ev)->flags = !!(trace_); } while (0)
@@ -708,6 +984,9 @@ EV_API_DECL void ev_resume  (EV_P) EV_NOEXCEPT;
 #define ev_fork_set(ev)                      /* nop, yes, this is a serious in-joke */
 #define ev_cleanup_set(ev)                   /* nop, yes, this is a serious in-joke */
 #define ev_async_set(ev)                     /* nop, yes, this is a serious in-joke */
+#define ev_channel_set(ev,limit_)            do { (ev)->limit = (limit_); (ev)->queue = (ev)->msgs = 0; (ev)->count = (ev)->sent = 0; } while (0)
+#define ev_work_set(ev,work_)                do { (ev)->work = (work_); (ev)->state = 0; } while (0)
+#define ev_uring_set(ev,op_,fd_,buf_,len_,off_,flags_) do { (ev)->op = (op_); (ev)->fd = (fd_); (ev)->buf = (buf_); (ev)->len = (len_); (ev)->off = (off_); (ev)->flags = (flags_); } while (0)
 
 #define ev_io_init(ev,cb,fd,events)          do { ev_init ((ev), (cb)); ev_io_set ((ev),(fd),(events)); } while (0)
 #define ev_timer_init(ev,cb,after,repeat)    do { ev_init ((ev), (cb)); ev_timer_set ((ev),(after),(repeat)); } while (0)
@@ -722,6 +1001,17 @@ EV_API_DECL void ev_resume  (EV_P) EV_NOEXCEPT;
 #define ev_fork_init(ev,cb)                  do { ev_init ((ev), (cb)); ev_fork_set ((ev)); } while (0)
 #define ev_cleanup_init(ev,cb)               do { ev_init ((ev), (cb)); ev_cleanup_set ((ev)); } while (0)
 #define ev_async_init(ev,cb)                 do { ev_init ((ev), (cb)); ev_async_set ((ev)); } while (0)
+#define ev_channel_init(ev,cb,limit)         do { ev_init ((ev), (cb)); ev_channel_set ((ev),(limit)); } while (0)
+#define ev_work_init(ev,cb,work)             do { ev_init ((ev), (cb)); ev_work_set ((ev),(work)); } while (0)
+#define ev_uring_init(ev,cb,op,fd,buf,len,off,flags) do { ev_init ((ev), (cb)); ev_uring_set ((ev),(op),(fd),(buf),(len),(off),(flags)); } while (0)
+
+#define ev_uring_read_init(ev,cb,fd,buf,len,off)   ev_uring_init ((ev), (cb), EV_URING_READ   , (fd), (buf), (len), (off), 0)
+#define ev_uring_write_init(ev,cb,fd,buf,len,off)  ev_uring_init ((ev), (cb), EV_URING_WRITE  , (fd), (buf), (len), (off), 0)
+#define ev_uring_accept_init(ev,cb,fd,sa,salen,fl) ev_uring_init ((ev), (cb), EV_URING_ACCEPT , (fd), (sa) , (salen), -1, (fl))
+#define ev_uring_recv_init(ev,cb,fd,buf,len,fl)    ev_uring_init ((ev), (cb), EV_URING_RECV   , (fd), (buf), (len), -1, (fl))
+#define ev_uring_send_init(ev,cb,fd,buf,len,fl)    ev_uring_init ((ev), (cb), EV_URING_SEND   , (fd), (buf), (len), -1, (fl))
+#define ev_uring_recvmsg_init(ev,cb,fd,msg,fl)     ev_uring_init ((ev), (cb), EV_URING_RECVMSG, (fd), (msg), 1    , -1, (fl))
+#define ev_uring_sendmsg_init(ev,cb,fd,msg,fl)     ev_uring_init ((ev), (cb), EV_URING_SENDMSG, (fd), (msg), 1    , -1, (fl))
 
 #define ev_is_pending(ev)                    (0 + ((ev_watcher *)(void *)(ev))->pending) /* ro, true when watcher is waiting for callback invocation */
 #define ev_is_active(ev)                     (0 + ((ev_watcher *)(void *)(ev))->active) /* ro, true when the watcher has been started */
@@ -738,6 +1028,7 @@ EV_API_DECL void ev_resume  (EV_P) EV_NOEXCEPT;
 #endif
 
 #define ev_periodic_at(ev)                   (+((ev_watcher_time *)(ev))->at)
+#define ev_uring_busy(ev)                    (0 + !!((ev)->wflags & EV__WF_BUSY)) /* ro, true while the kernel still owns the buffer of a stopped ev_uring */
 
 #ifndef ev_set_cb
 /* memmove is used here to avoid strict aliasing violations, and hopefully is optimized out by any reasonable compiler */
@@ -764,6 +1055,8 @@ EV_API_DECL void ev_io_stop        (EV_P_ ev_io *w) EV_NOEXCEPT;
 
 EV_API_DECL void ev_timer_start    (EV_P_ ev_timer *w) EV_NOEXCEPT;
 EV_API_DECL void ev_timer_stop     (EV_P_ ev_timer *w) EV_NOEXCEPT;
+/* starts count timers, but rebuilds the timer heap only once */
+EV_API_DECL void ev_timer_start_many (EV_P_ ev_timer **w, int count) EV_NOEXCEPT;
 /* stops if active and no repeat, restarts if active and repeating, starts if inactive and repeating */
 EV_API_DECL void ev_timer_again    (EV_P_ ev_timer *w) EV_NOEXCEPT;
 /* return remaining time */
@@ -773,6 +1066,7 @@ EV_API_DECL ev_tstamp ev_timer_remaining (EV_P_ ev_timer *w) EV_NOEXCEPT;
 EV_API_DECL void ev_periodic_start (EV_P_ ev_periodic *w) EV_NOEXCEPT;
 EV_API_DECL void ev_periodic_stop  (EV_P_ ev_periodic *w) EV_NOEXCEPT;
 EV_API_DECL void ev_periodic_again (EV_P_ ev_periodic *w) EV_NOEXCEPT;
+EV_API_DECL void ev_periodic_start_many (EV_P_ ev_periodic **w, int count) EV_NOEXCEPT;
 #endif
 
 /* only supported in the default loop */
@@ -831,6 +1125,34 @@ EV_API_DECL void ev_async_stop     (EV_P_ ev_async *w) EV_NOEXCEPT;
 EV_API_DECL void ev_async_send     (EV_P_ ev_async *w) EV_NOEXCEPT;
 # endif
 
+# if EV_CHANNEL_ENABLE
+EV_API_DECL void ev_channel_start  (EV_P_ ev_channel *w) EV_NOEXCEPT;
+EV_API_DECL void ev_channel_stop   (EV_P_ ev_channel *w) EV_NOEXCEPT;
+/* thread-safe, returns 0 if the channel is full */
+EV_API_DECL int  ev_channel_send   (EV_P_ ev_channel *w, ev_channel_msg *msg) EV_NOEXCEPT;
+/* returns all messages received so far, oldest first, chained via next */
+EV_API_DECL ev_channel_msg *ev_channel_recv (EV_P_ ev_channel *w) EV_NOEXCEPT;
+# endif
+
+# if EV_WORK_ENABLE
+/* queues the work function on the pool, the watcher stops itself when it has run */
+EV_API_DECL void ev_work_start     (EV_P_ ev_work *w) EV_NOEXCEPT;
+/* blocks while the work function is running */
+EV_API_DECL void ev_work_stop      (EV_P_ ev_work *w) EV_NOEXCEPT;
+# endif
+
+# if EV_URING_ENABLE
+/* submits the operation, the watcher stops itself when it completes */
+EV_API_DECL void ev_uring_start    (EV_P_ ev_uring *w) EV_NOEXCEPT;
+EV_API_DECL void ev_uring_stop     (EV_P_ ev_uring *w) EV_NOEXCEPT;
+
+/* sets up a pool of count (a power of two) buffers of size bytes each, */
+/* used by reads and recvs with a null buffer */
+EV_API_DECL void ev_uring_buffers  (EV_P_ unsigned int count, unsigned int size) EV_NOEXCEPT;
+/* hands a pool buffer received in a completion back to the pool */
+EV_API_DECL void ev_uring_release  (EV_P_ void *buf) EV_NOEXCEPT;
+# endif
+
 #if EV_COMPAT3
   #define EVLOOP_NONBLOCK EVRUN_NOWAIT
   #define EVLOOP_ONESHOT  EVRUN_ONCE
@@ -64,62 +64,117 @@
  */
 
 #include <sys/epoll.h>
+#include <sys/ioctl.h>
 
 #define EV_EMASK_EPERM 0x80
 
-static void
-epoll_modify (EV_P_ int fd, int oev, int nev)
+/* 4.5+, older kernels silently ignore it */
+#ifndef EPOLLEXCLUSIVE
+# define EPOLLEXCLUSIVE (1U << 28)
+#endif
+
+/* default spin budget for EVFLAG_BUSYPOLL */
+#ifndef EV_BUSYPOLL_INTERVAL
+# define EV_BUSYPOLL_INTERVAL 50e-6
+#endif
+
+#ifdef SYS_epoll_pwait2
+/* epoll_pwait2 always takes the 64 bit kernel timespec */
+struct epoll_kernel_timespec
 {
-  struct epoll_event ev;
-  unsigned char oldmask;
+  int64_t tv_sec;
+  long long tv_nsec;
+};
+#endif
 
-  /*
-   * we handle EPOLL_CTL_DEL by ignoring it here
-   * on the assumption that the fd is gone anyways
-   * if that is wrong, we have to handle the spurious
-   * event in epoll_poll.
-   * if the fd is added again, we try to ADD it, and, if that
-   * fails, we assume it still has the same eventmask.
-   */
-  if (!nev)
-    return;
+/* how many events ahead epoll_poll prefetches the per-fd state */
+#define EPOLL_PREFETCH 4
 
-  oldmask = anfds [fd].emask;
-  anfds [fd].emask = nev;
+/* 6.9+, lets the kernel busy-poll the network queues of our sockets as well */
+#ifndef EPIOCSPARAMS
+struct epoll_params
+{
+  uint32_t busy_poll_usecs;
+  uint16_t busy_poll_budget;
+  uint8_t  prefer_busy_poll;
+  uint8_t  pad;
+};
+# define EPIOCSPARAMS _IOW (0x8A, 0x01, struct epoll_params)
+#endif
 
-  /* store the generation counter in the upper 32 bits, the fd in the lower 32 bits */
-  ev.data.u64 = (uint64_t)(uint32_t)fd
-              | ((uint64_t)(uint32_t)++anfds [fd].egen << 32);
-  ev.events   = (nev & EV_READ  ? EPOLLIN  : 0)
-              | (nev & EV_WRITE ? EPOLLOUT : 0);
+/*
+ * with EVFLAG_EPOLL_BATCH, we do not call epoll_ctl right away, but
+ * record the change in a journal, which gets flushed just before
+ * epoll_wait, with a single io_uring_enter if the kernel supports
+ * IORING_OP_EPOLL_CTL (5.6+). fd_reify already coalesces all watcher
+ * changes for an fd into one backend_modify call, and the journal keeps
+ * at most one entry per fd (marked by EV_EFLAG_QUEUED), so changes that
+ * cancel out, such as quieting an fd in epoll_poll and re-enabling it
+ * from a callback, cost no syscall at all.
+ */
+#define EV_EFLAG_QUEUED 0x01
 
-  if (ecb_expect_true (!epoll_ctl (backend_fd, oev && oldmask != nev ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, fd, &ev)))
-    return;
+struct epoll_change
+{
+  int fd;
+  int op;
+  struct epoll_event ev;
+  unsigned int ogen;   /* generation counter the kernel knows */
+  unsigned char omask; /* kernel mask before the change */
+  unsigned char mask;  /* kernel mask after the change */
+  unsigned char quiet; /* true if queued by epoll_poll, false if by epoll_modify */
+  int res;             /* 0 or -errno, filled in by epoll_flush */
+};
+
+#if EV_USE_IOURING
+/* in ev_iouring.c */
+static int iouring_epoll_init (EV_P);
+static void iouring_epoll_ctl (EV_P_ struct epoll_change *changes, int cnt);
+static int iouring_internal_destroy (EV_P);
+#endif
+
+/* EPOLLEXCLUSIVE registrations cannot be modified, only removed and added again */
+inline_size
+int
+epoll_exclusive_op (EV_P_ int fd, int op, struct epoll_event *ev, unsigned char omask, unsigned char mask)
+{
+  if (ecb_expect_false (op == EPOLL_CTL_MOD && (omask | mask) & EV_EXCLUSIVE))
+    {
+      epoll_ctl (backend_fd, EPOLL_CTL_DEL, fd, ev);
+      op = EPOLL_CTL_ADD;
+    }
+
+  return op;
+}
 
-  if (ecb_expect_true (errno == ENOENT))
+/* epoll_ctl failed on behalf of epoll_modify, try to do the right thing */
+static void
+epoll_modify_failed (EV_P_ int fd, struct epoll_event *ev, int nev, unsigned char oldmask, unsigned int ogen, int err)
+{
+  if (ecb_expect_true (err == ENOENT))
     {
       /* if ENOENT then the fd went away, so try to do the right thing */
       if (!nev)
         goto dec_egen;
 
-      if (!epoll_ctl (backend_fd, EPOLL_CTL_ADD, fd, &ev))
+      if (!epoll_ctl (backend_fd, EPOLL_CTL_ADD, fd, ev))
         return;
     }
-  else if (ecb_expect_true (errno == EEXIST))
+  else if (ecb_expect_true (err == EEXIST))
     {
       /* EEXIST means we ignored a previous DEL, but the fd is still active */
       /* if the kernel mask is the same as the new mask, we assume it hasn't changed */
       if (oldmask == nev)
         goto dec_egen;
 
-      if (!epoll_ctl (backend_fd, EPOLL_CTL_MOD, fd, &ev))
+      if (!epoll_ctl (backend_fd, epoll_exclusive_op (EV_A_ fd, EPOLL_CTL_MOD, ev, oldmask, nev), fd, ev))
         return;
     }
-  else if (ecb_expect_true (errno == EPERM))
+  else if (ecb_expect_true (err == EPERM))
     {
       /* EPERM means the fd is always ready, but epoll is too snobbish */
       /* to handle it, unlike select or poll. */
-      anfds [fd].emask = EV_EMASK_EPERM;
+      ANFD_at (fd).emask = EV_EMASK_EPERM;
 
       /* add fd to epoll_eperms, if not already inside */
       if (!(oldmask & EV_EMASK_EPERM))
@@ -131,13 +186,246 @@ epoll_modify (EV_P_ int fd, int oev, int nev)
       return;
     }
   else
-    assert (("libev: I/O watcher with invalid fd found in epoll_ctl", errno != EBADF && errno != ELOOP && errno != EINVAL));
+    assert (("libev: I/O watcher with invalid fd found in epoll_ctl", err != EBADF && err != ELOOP && err != EINVAL));
 
   fd_kill (EV_A_ fd);
 
 dec_egen:
-  /* we didn't successfully call epoll_ctl, so decrement the generation counter again */
-  --anfds [fd].egen;
+  /* we didn't successfully call epoll_ctl, so restore the generation counter again */
+  ANFD_at (fd).egen = ogen;
+}
+
+static void
+epoll_queue (EV_P_ int fd, int op, struct epoll_event *ev, unsigned char omask, unsigned char mask, unsigned int ogen, int quiet)
+{
+  ANFD *anfd = &ANFD_at (fd);
+  struct epoll_change *c;
+
+  if (ecb_expect_false (anfd->eflags & EV_EFLAG_QUEUED))
+    {
+      /* merge with the pending change, which usually is one of the last ones */
+      for (c = epoll_changes + epoll_changecnt; (--c)->fd != fd; )
+        ;
+
+      if (c->op == EPOLL_CTL_ADD)
+        {
+          /* the kernel might not know the fd (anymore) */
+          if (op != EPOLL_CTL_DEL)
+            op = EPOLL_CTL_ADD;
+        }
+      /* a change from epoll_poll means the kernel knows the fd for sure */
+      else if (c->quiet && op != EPOLL_CTL_DEL)
+        {
+          if (mask == c->omask)
+            {
+              /* back to what the kernel has, forget about it */
+              anfd->egen   = c->ogen;
+              anfd->emask  = c->omask;
+              anfd->eflags &= ~EV_EFLAG_QUEUED;
+              *c = epoll_changes [--epoll_changecnt];
+              return;
+            }
+
+          op = EPOLL_CTL_MOD;
+        }
+
+      omask = c->omask;
+      ogen  = c->ogen;
+      quiet = quiet && c->quiet;
+    }
+  else
+    {
+      anfd->eflags |= EV_EFLAG_QUEUED;
+      array_needsize (struct epoll_change, epoll_changes, epoll_changemax, epoll_changecnt + 1, array_needsize_noinit);
+      c = epoll_changes + epoll_changecnt++;
+    }
+
+  /* only now we know whether the kernel sees a MOD at all */
+  op = epoll_exclusive_op (EV_A_ fd, op, ev, omask, mask);
+
+  c->fd    = fd;
+  c->op    = op;
+  c->ev    = *ev;
+  c->ogen  = ogen;
+  c->omask = omask;
+  c->mask  = mask;
+  c->quiet = quiet;
+}
+
+/* apply all journalled changes, called before we wait */
+static void
+epoll_flush (EV_P)
+{
+  int i;
+
+#if EV_USE_IOURING
+  if (epoll_batch > 1)
+    iouring_epoll_ctl (EV_A_ epoll_changes, epoll_changecnt);
+  else
+#endif
+    for (i = 0; i < epoll_changecnt; ++i)
+      {
+        struct epoll_change *c = epoll_changes + i;
+
+        c->res = epoll_ctl (backend_fd, c->op, c->fd, &c->ev) ? -errno : 0;
+      }
+
+  for (i = 0; i < epoll_changecnt; ++i)
+    {
+      struct epoll_change *c = epoll_changes + i;
+
+      ANFD_at (c->fd).eflags &= ~EV_EFLAG_QUEUED;
+
+      if (ecb_expect_false (c->res < 0))
+        {
+          if (c->quiet)
+            postfork |= 2; /* an error occurred, recreate kernel state */
+          else
+            epoll_modify_failed (EV_A_ c->fd, &c->ev, c->mask, c->omask, c->ogen, -c->res);
+        }
+    }
+
+  epoll_changecnt = 0;
+}
+
+static void
+epoll_modify (EV_P_ int fd, int oev, int nev)
+{
+  struct epoll_event ev;
+  unsigned char oldmask;
+  int op;
+
+  /*
+   * we handle EPOLL_CTL_DEL by ignoring it here
+   * on the assumption that the fd is gone anyways
+   * if that is wrong, we have to handle the spurious
+   * event in epoll_poll.
+   * if the fd is added again, we try to ADD it, and, if that
+   * fails, we assume it still has the same eventmask.
+   */
+  if (!nev)
+    return;
+
+  oldmask = ANFD_at (fd).emask;
+  ANFD_at (fd).emask = nev;
+
+  /* store the generation counter in the upper 32 bits, the fd in the lower 32 bits */
+  ev.data.u64 = (uint64_t)(uint32_t)fd
+              | ((uint64_t)(uint32_t)++ANFD_at (fd).egen << 32);
+  ev.events   = (nev & EV_READ  ? EPOLLIN  : 0)
+              | (nev & EV_WRITE ? EPOLLOUT : 0)
+              | (nev & EV_EDGE  ? EPOLLET  : 0)
+              | (nev & EV_EXCLUSIVE ? EPOLLEXCLUSIVE : 0);
+
+  op = oev && oldmask != nev ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+
+  if (ecb_expect_false (epoll_batch))
+    epoll_queue (EV_A_ fd, op, &ev, oldmask, nev, ANFD_at (fd).egen - 1, 0);
+  else if (ecb_expect_false (epoll_ctl (backend_fd, epoll_exclusive_op (EV_A_ fd, op, &ev, oldmask, nev), fd, &ev)))
+    epoll_modify_failed (EV_A_ fd, &ev, nev, oldmask, ANFD_at (fd).egen - 1, errno);
+}
+
+ecb_cold
+static void
+epoll_busypoll_set (EV_P_ ev_tstamp interval)
+{
+  struct epoll_params params = { 0 };
+
+  busypoll_budget = interval;
+  busypoll_window = interval;
+  busypoll_gap    = interval / 2;
+  busypoll_last   = get_clock ();
+
+  /* fails on older kernels, and the kernel ignores it for non-network fds */
+  params.busy_poll_usecs = EV_TS_TO_SEC (interval) * 1e6;
+  ioctl (backend_fd, EPIOCSPARAMS, &params);
+}
+
+/* block for at most timeout, to the nanosecond with epoll_pwait2 (5.11+), */
+/* otherwise rounded up to whole milliseconds */
+inline_speed int
+epoll_wait_timeout (EV_P_ ev_tstamp timeout)
+{
+#ifdef SYS_epoll_pwait2
+  if (ecb_expect_true (epoll_nswait))
+    {
+      struct epoll_kernel_timespec ts;
+      int res;
+
+      EV_TS_SET (ts, timeout);
+      res = ev_syscall6 (SYS_epoll_pwait2, backend_fd, epoll_events, epoll_eventmax, &ts, 0, 0);
+
+      if (ecb_expect_true (res >= 0 || errno != ENOSYS))
+        return res;
+
+      /* filtered by a sandbox, most likely, so fall back for good */
+      epoll_nswait = 0;
+
+      if (backend_mintime < EV_TS_CONST (1e-3))
+        backend_mintime = EV_TS_CONST (1e-3);
+    }
+#endif
+
+  return epoll_wait (backend_fd, epoll_events, epoll_eventmax, EV_TS_TO_MSEC (timeout));
+}
+
+/* spin with non-blocking epoll_waits for a while, then block for the rest */
+static int
+epoll_busypoll (EV_P_ ev_tstamp timeout)
+{
+  /* short timeouts are spun away completely, to not oversleep */
+  ev_tstamp spin = timeout <= busypoll_budget ? timeout : busypoll_window;
+
+  if (spin > EV_TS_CONST (0.))
+    {
+      ev_tstamp start = get_clock ();
+      ev_tstamp now;
+      int eventcnt;
+
+      ++busypoll_spins;
+
+      do
+        {
+          eventcnt = epoll_wait (backend_fd, epoll_events, epoll_eventmax, 0);
+
+          if (eventcnt)
+            {
+              busypoll_hits += eventcnt > 0;
+              return eventcnt;
+            }
+
+          now = get_clock ();
+        }
+      while (now - start < spin);
+
+      if (spin >= timeout)
+        return 0;
+
+      timeout -= now - start;
+    }
+
+  return epoll_wait_timeout (EV_A_ timeout);
+}
+
+/* adapt the spin window to the time between events: spin for up to */
+/* twice the average gap, or not at all when events are too rare */
+inline_size
+void
+epoll_busypoll_adapt (EV_P)
+{
+  ev_tstamp now = get_clock ();
+  ev_tstamp gap = now - busypoll_last;
+
+  /* cap long idle periods, so the window recovers quickly */
+  if (gap > busypoll_budget * 4)
+    gap = busypoll_budget * 4;
+
+  busypoll_last = now;
+  busypoll_gap += (gap - busypoll_gap) / 8;
+
+  busypoll_window = busypoll_gap >= busypoll_budget ? EV_TS_CONST (0.)
+                  : busypoll_gap * 2 < busypoll_budget ? busypoll_gap * 2
+                  : busypoll_budget;
 }
 
 static void
@@ -146,13 +434,19 @@ epoll_poll (EV_P_ ev_tstamp timeout)
   int i;
   int eventcnt;
 
+  if (ecb_expect_false (epoll_changecnt))
+    epoll_flush (EV_A);
+
   if (ecb_expect_false (epoll_epermcnt))
     timeout = EV_TS_CONST (0.);
 
   /* epoll wait times cannot be larger than (LONG_MAX - 999UL) / HZ msecs, which is below */
   /* the default libev max wait time, however. */
   EV_RELEASE_CB;
-  eventcnt = epoll_wait (backend_fd, epoll_events, epoll_eventmax, EV_TS_TO_MSEC (timeout));
+  if (ecb_expect_false (busypoll_budget) && timeout > EV_TS_CONST (0.))
+    eventcnt = epoll_busypoll (EV_A_ timeout);
+  else
+    eventcnt = epoll_wait_timeout (EV_A_ timeout);
   EV_ACQUIRE_CB;
 
   if (ecb_expect_false (eventcnt < 0))
@@ -163,14 +457,23 @@ epoll_poll (EV_P_ ev_tstamp timeout)
       return;
     }
 
+  if (ecb_expect_false (busypoll_budget) && eventcnt)
+    epoll_busypoll_adapt (EV_A);
+
   for (i = 0; i < eventcnt; ++i)
     {
       struct epoll_event *ev = epoll_events + i;
 
       int fd = (uint32_t)ev->data.u64; /* mask out the lower 32 bits */
-      int want = anfds [fd].events;
-      int got  = (ev->events & (EPOLLOUT | EPOLLERR | EPOLLHUP) ? EV_WRITE : 0)
-               | (ev->events & (EPOLLIN  | EPOLLERR | EPOLLHUP) ? EV_READ  : 0);
+      int want;
+      int got;
+
+      if (ecb_expect_true (i + EPOLL_PREFETCH < eventcnt))
+        fd_prefetch (EV_A_ (uint32_t)epoll_events [i + EPOLL_PREFETCH].data.u64);
+
+      want = ANFD_at (fd).events;
+      got  = (ev->events & (EPOLLOUT | EPOLLERR | EPOLLHUP) ? EV_WRITE : 0)
+           | (ev->events & (EPOLLIN  | EPOLLERR | EPOLLHUP) ? EV_READ  : 0);
 
       /*
        * check for spurious notification.
@@ -178,16 +481,24 @@ epoll_poll (EV_P_ ev_tstamp timeout)
        * other spurious notifications will be found by epoll_ctl, below
        * we assume that fd is always in range, as we never shrink the anfds array
        */
-      if (ecb_expect_false ((uint32_t)anfds [fd].egen != (uint32_t)(ev->data.u64 >> 32)))
+      if (ecb_expect_false ((uint32_t)ANFD_at (fd).egen != (uint32_t)(ev->data.u64 >> 32)))
         {
           /* recreate kernel state */
           postfork |= 2;
           continue;
         }
 
-      if (ecb_expect_false (got & ~want))
+      /*
+       * edge-triggered fds only get reported again when their state changes,
+       * so an unwanted EPOLLERR or EPOLLHUP is not worth an epoll_ctl call,
+       * and exclusive ones could only be re-added, not modified.
+       * fds without watchers never have these flags set, so they still get quieted.
+       */
+      if (ecb_expect_false (got & ~want) && !(want & (EV_EDGE | EV_EXCLUSIVE)))
         {
-          anfds [fd].emask = want;
+          unsigned char omask = ANFD_at (fd).emask;
+
+          ANFD_at (fd).emask = want;
 
           /*
            * we received an event but are not interested in it, try mod or del
@@ -203,9 +514,12 @@ epoll_poll (EV_P_ ev_tstamp timeout)
           ev->events = (want & EV_READ  ? EPOLLIN  : 0)
                      | (want & EV_WRITE ? EPOLLOUT : 0);
 
+          /* if the callbacks re-enable the fd, this costs nothing */
+          if (epoll_batch)
+            epoll_queue (EV_A_ fd, want ? EPOLL_CTL_MOD : EPOLL_CTL_DEL, ev, omask, want, ANFD_at (fd).egen, 1);
           /* pre-2.6.9 kernels require a non-null pointer with EPOLL_CTL_DEL, */
           /* which is fortunately easy to do for us. */
-          if (epoll_ctl (backend_fd, want ? EPOLL_CTL_MOD : EPOLL_CTL_DEL, fd, ev))
+          else if (epoll_ctl (backend_fd, want ? EPOLL_CTL_MOD : EPOLL_CTL_DEL, fd, ev))
             {
               postfork |= 2; /* an error occurred, recreate kernel state */
               continue;
@@ -227,14 +541,14 @@ epoll_poll (EV_P_ ev_tstamp timeout)
   for (i = epoll_epermcnt; i--; )
     {
       int fd = epoll_eperms [i];
-      unsigned char events = anfds [fd].events & (EV_READ | EV_WRITE);
+      unsigned char events = ANFD_at (fd).events & (EV_READ | EV_WRITE);
 
-      if (anfds [fd].emask & EV_EMASK_EPERM && events)
+      if (ANFD_at (fd).emask & EV_EMASK_EPERM && events)
         fd_event (EV_A_ fd, events);
       else
         {
           epoll_eperms [i] = epoll_eperms [--epoll_epermcnt];
-          anfds [fd].emask = 0;
+          ANFD_at (fd).emask = 0;
         }
     }
 }
@@ -266,13 +580,35 @@ epoll_init (EV_P_ int flags)
   if ((backend_fd = epoll_epoll_create ()) < 0)
     return 0;
 
-  backend_mintime = EV_TS_CONST (1e-3); /* epoll does sometimes return early, this is just to avoid the worst */
+#ifdef SYS_epoll_pwait2
+  epoll_nswait = ev_linux_version () >= 0x050b00;
+#else
+  epoll_nswait = 0;
+#endif
+
+  /* epoll_wait does sometimes return early, this is just to avoid the worst, */
+  /* epoll_pwait2 uses high resolution timers, which never do */
+  backend_mintime = epoll_nswait ? EV_TS_CONST (1e-9) : EV_TS_CONST (1e-3);
   backend_modify  = epoll_modify;
   backend_poll    = epoll_poll;
 
   epoll_eventmax = 64; /* initial number of events receivable per poll */
   epoll_events = (struct epoll_event *)ev_malloc (sizeof (struct epoll_event) * epoll_eventmax);
 
+  epoll_batch = 0;
+
+  if (flags & EVFLAG_BUSYPOLL)
+    epoll_busypoll_set (EV_A_ EV_TS_CONST (EV_BUSYPOLL_INTERVAL));
+
+  if (flags & EVFLAG_EPOLL_BATCH)
+    {
+      epoll_batch = 1;
+#if EV_USE_IOURING
+      if (iouring_epoll_init (EV_A))
+        epoll_batch = 2;
+#endif
+    }
+
   return EVBACKEND_EPOLL;
 }
 
@@ -280,19 +616,47 @@ inline_size
 void
 epoll_destroy (EV_P)
 {
+#if EV_USE_IOURING
+  if (epoll_batch > 1)
+    iouring_internal_destroy (EV_A);
+#endif
+
   ev_free (epoll_events);
   array_free (epoll_eperm, EMPTY);
+  array_free (epoll_change, EMPTY);
 }
 
 ecb_cold
 static void
 epoll_fork (EV_P)
 {
+  /* the journal refers to the old epoll set, fd_rearm_all redoes it all */
+  while (epoll_changecnt)
+    {
+      int fd = epoll_changes [--epoll_changecnt].fd;
+
+      ANFD_at (fd).eflags &= ~EV_EFLAG_QUEUED;
+    }
+
+#if EV_USE_IOURING
+  /* the ring is shared with the parent */
+  if (epoll_batch > 1)
+    {
+      iouring_internal_destroy (EV_A);
+
+      if (!iouring_epoll_init (EV_A))
+        epoll_batch = 1;
+    }
+#endif
+
   close (backend_fd);
 
   while ((backend_fd = epoll_epoll_create ()) < 0)
     ev_syserr ("(libev) epoll_create");
 
+  if (busypoll_budget)
+    epoll_busypoll_set (EV_A_ busypoll_budget);
+
   fd_rearm_all (EV_A);
 }
 
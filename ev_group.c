@@ -0,0 +1,342 @@
+/*
+ * libev loop groups, one event loop per cpu, each in its own thread
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modifica-
+ * tion, are permitted provided that the following conditions are met:
+ *
+ *   1.  Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *   2.  Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MER-
+ * CHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPE-
+ * CIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTH-
+ * ERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * the GNU General Public License ("GPL") version 2 or any later version,
+ * in which case the provisions of the GPL are applicable instead of
+ * the above. If you wish to allow the use of your version of this file
+ * only under the terms of the GPL and not to allow others to use your
+ * version of this file under the BSD license, indicate your decision
+ * by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL. If you do not delete the
+ * provisions above, a recipient may use your version of this file under
+ * either the BSD or the GPL.
+ */
+
+/*
+ * a loop group is just a bunch of ev_loop_new loops, each run by ev_run
+ * in a thread of its own, optionally pinned to a cpu of its own. all
+ * communication with the loops is done through one ev_channel per loop,
+ * which carries "run this function on your thread" requests. that keeps
+ * the one-thread-per-loop rule intact: anything that touches a loop,
+ * such as starting watchers for a new connection, is done by submitting
+ * a function to it.
+ */
+
+#include <pthread.h>
+#include <signal.h>
+
+#ifdef __linux
+# include <sys/syscall.h>
+#endif
+
+/* a submitted function, queued on the channel of its loop */
+typedef struct
+{
+  ev_channel_msg msg; /* must be first */
+  void (*cb)(EV_P_ void *data);
+  void *data;
+} ANJOB;
+
+typedef struct
+{
+  struct ev_loop *loop;
+  ev_channel channel;
+  ANJOB quit;             /* preallocated, so breaking the loop cannot fail */
+  EV_ATOMIC_T quitting;
+  int queued;             /* jobs submitted but not yet run */
+  int cpu;                /* -1 if not pinned */
+  pthread_t thread;
+} ANGROUP;
+
+struct ev_loop_group
+{
+  ANGROUP *loops;
+  unsigned int count;
+  unsigned int flags;
+  int next; /* round-robin cursor */
+};
+
+/* the cpus we are allowed to run on, in ascending order, returns their number */
+static unsigned int
+group_cpus (int *cpus, unsigned int max)
+{
+  unsigned int n = 0;
+
+#if defined __linux && defined SYS_sched_getaffinity
+  {
+    unsigned long mask [1024 / (8 * sizeof (unsigned long))];
+    long len = syscall (SYS_sched_getaffinity, 0, sizeof (mask), mask);
+    int cpu;
+
+    if (len > 0)
+      for (cpu = 0; cpu < len * 8 && n < max; ++cpu)
+        if (mask [cpu / (8 * sizeof (unsigned long))] & (1UL << (cpu % (8 * sizeof (unsigned long)))))
+          cpus [n++] = cpu;
+  }
+#endif
+
+#ifdef _SC_NPROCESSORS_ONLN
+  if (!n)
+    {
+      long cnt = sysconf (_SC_NPROCESSORS_ONLN);
+
+      /* we cannot pin without the affinity syscall, so do not pretend we can */
+      for (n = 0; n < cnt && n < max; ++n)
+        cpus [n] = -1;
+    }
+#endif
+
+  return n;
+}
+
+static void
+group_pin (int cpu)
+{
+#if defined __linux && defined SYS_sched_setaffinity
+  unsigned long mask [1024 / (8 * sizeof (unsigned long))] = { 0 };
+
+  if (cpu < 0 || cpu >= 1024)
+    return;
+
+  mask [cpu / (8 * sizeof (unsigned long))] = 1UL << (cpu % (8 * sizeof (unsigned long)));
+
+  /* pid 0 is the calling thread, and failure just means we stay unpinned */
+  syscall (SYS_sched_setaffinity, 0, sizeof (mask), mask);
+#endif
+}
+
+static void
+group_quit_cb (EV_P_ void *data)
+{
+  ev_break (EV_A_ EVBREAK_ALL);
+}
+
+static void
+group_channel_cb (EV_P_ ev_channel *w, int revents)
+{
+  ANGROUP *l = (ANGROUP *)w->data;
+  ev_channel_msg *msg, *next;
+
+  for (msg = ev_channel_recv (EV_A_ w); msg; msg = next)
+    {
+      ANJOB *job = (ANJOB *)msg;
+
+      next = msg->next;
+      job->cb (EV_A_ job->data);
+
+      if (job != &l->quit)
+        ev_free (job);
+
+      ev_atomic_add_int (&l->queued, -1);
+    }
+}
+
+static void *
+group_thread (void *arg)
+{
+  ANGROUP *l = (ANGROUP *)arg;
+
+  group_pin (l->cpu);
+  ev_run (l->loop, 0);
+
+  return 0;
+}
+
+static void
+group_quit (ANGROUP *l)
+{
+  if (ev_atomic_xchg_int (&l->quitting, 1))
+    return;
+
+  ev_atomic_add_int (&l->queued, 1);
+  ev_channel_send (l->loop, &l->channel, &l->quit.msg);
+}
+
+/* joins the first "threads" threads and frees everything */
+static void
+group_free (ev_loop_group *group, unsigned int threads)
+{
+  unsigned int i;
+
+  for (i = 0; i < threads; ++i)
+    pthread_join (group->loops [i].thread, 0);
+
+  for (i = 0; i < group->count; ++i)
+    {
+      ANGROUP *l = group->loops + i;
+      ev_channel_msg *msg, *next;
+
+      if (!l->loop)
+        continue;
+
+      /* whatever was submitted after the break is never run */
+      for (msg = ev_channel_recv (l->loop, &l->channel); msg; msg = next)
+        {
+          next = msg->next;
+
+          if (msg != &l->quit.msg)
+            ev_free (msg);
+        }
+
+      ev_channel_stop (l->loop, &l->channel);
+      ev_loop_destroy (l->loop);
+    }
+
+  ev_free (group->loops);
+  ev_free (group);
+}
+
+ev_loop_group *
+ev_loop_group_new (unsigned int count, unsigned int flags, unsigned int gflags) EV_NOEXCEPT
+{
+  ev_loop_group *group;
+  sigset_t fullset, prevset;
+  int cpus [1024];
+  unsigned int ncpu = group_cpus (cpus, sizeof (cpus) / sizeof (cpus [0]));
+  unsigned int i;
+
+  if (!count)
+    count = ncpu ? ncpu : 1;
+
+  group = (ev_loop_group *)ev_malloc (sizeof (ev_loop_group));
+  group->loops = (ANGROUP *)ev_malloc (sizeof (ANGROUP) * count);
+  memset (group->loops, 0, sizeof (ANGROUP) * count);
+  group->count = count;
+  group->flags = gflags;
+  group->next  = 0;
+
+  for (i = 0; i < count; ++i)
+    {
+      ANGROUP *l = group->loops + i;
+
+      if (!(l->loop = ev_loop_new (flags)))
+        {
+          group_free (group, 0);
+          return 0;
+        }
+
+      l->cpu = ncpu && !(gflags & EVGROUP_NOAFFINITY) ? cpus [i % ncpu] : -1;
+      l->quit.cb = group_quit_cb;
+
+      ev_channel_init (&l->channel, group_channel_cb, 0);
+      l->channel.data = (void *)l;
+      ev_channel_start (l->loop, &l->channel);
+    }
+
+  /* the loop threads should not receive process-directed signals */
+  sigfillset (&fullset);
+  pthread_sigmask (SIG_SETMASK, &fullset, &prevset);
+
+  for (i = 0; i < count; ++i)
+    if (pthread_create (&group->loops [i].thread, 0, group_thread, (void *)(group->loops + i)))
+      {
+        unsigned int j;
+
+        pthread_sigmask (SIG_SETMASK, &prevset, 0);
+
+        for (j = 0; j < i; ++j)
+          group_quit (group->loops + j);
+
+        group_free (group, i);
+        return 0;
+      }
+
+  pthread_sigmask (SIG_SETMASK, &prevset, 0);
+
+  return group;
+}
+
+void
+ev_loop_group_destroy (ev_loop_group *group) EV_NOEXCEPT
+{
+  ev_loop_group_break (group);
+  group_free (group, group->count);
+}
+
+void
+ev_loop_group_break (ev_loop_group *group) EV_NOEXCEPT
+{
+  unsigned int i;
+
+  for (i = 0; i < group->count; ++i)
+    group_quit (group->loops + i);
+}
+
+unsigned int
+ev_loop_group_count (ev_loop_group *group) EV_NOEXCEPT
+{
+  return group->count;
+}
+
+struct ev_loop *
+ev_loop_group_loop (ev_loop_group *group, unsigned int index) EV_NOEXCEPT
+{
+  return group->loops [index % group->count].loop;
+}
+
+unsigned int
+ev_loop_group_pick (ev_loop_group *group) EV_NOEXCEPT
+{
+  if (group->flags & EVGROUP_LEASTLOADED)
+    {
+      unsigned int i, best = 0;
+      int best_load = 0;
+
+      /* these are racy reads of other threads' data, but a slightly */
+      /* outdated load is as good as an exact one for this purpose */
+      for (i = 0; i < group->count; ++i)
+        {
+          struct ev_loop *loop = group->loops [i].loop;
+          int load = *(volatile int *)&activecnt + *(volatile int *)&group->loops [i].queued;
+
+          if (!i || load < best_load)
+            {
+              best = i;
+              best_load = load;
+            }
+        }
+
+      return best;
+    }
+
+  return (unsigned int)ev_atomic_add_int (&group->next, 1) % group->count;
+}
+
+void
+ev_loop_group_submit (ev_loop_group *group, unsigned int index, void (*cb)(EV_P_ void *data), void *data) EV_NOEXCEPT
+{
+  ANGROUP *l = group->loops + index % group->count;
+  ANJOB *job = (ANJOB *)ev_malloc (sizeof (ANJOB));
+
+  job->cb   = cb;
+  job->data = data;
+
+  ev_atomic_add_int (&l->queued, 1);
+  ev_channel_send (l->loop, &l->channel, &job->msg);
+}
+
@@ -78,17 +78,22 @@
  *    competition.
  */
 
-/* TODO: use internal TIMEOUT */
 /* TODO: take advantage of single mmap, NODROP etc. */
 /* TODO: resize cq/sq size independently */
 
 #include <sys/timerfd.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <poll.h>
 #include <stdint.h>
 
 #define IOURING_INIT_ENTRIES 32
 
+/* milliseconds the sqpoll kernel thread spins before it goes to sleep */
+#ifndef EV_IOURING_SQPOLL_IDLE
+# define EV_IOURING_SQPOLL_IDLE 1000
+#endif
+
 /*****************************************************************************/
 /* syscall wrapdadoop - this section has the raw api/abi definitions */
 
@@ -124,10 +129,14 @@ struct io_uring_sqe
   __u64 user_data;
   union {
     __u16 buf_index;
+    __u16 buf_group;
     __u64 __pad2[3];
   };
 };
 
+#define IOSQE_FIXED_FILE    0x01
+#define IOSQE_BUFFER_SELECT 0x20
+
 struct io_uring_cqe
 {
   __u64 user_data;
@@ -135,6 +144,9 @@ struct io_uring_cqe
   __u32 flags;
 };
 
+#define IORING_CQE_F_BUFFER     0x00000001 /* buffer id in the upper 16 bits */
+#define IORING_CQE_BUFFER_SHIFT 16
+
 struct io_sqring_offsets
 {
   __u32 head;
@@ -172,23 +184,97 @@ struct io_uring_params
   struct io_cqring_offsets cq_off;
 };
 
+#define IORING_SETUP_SQPOLL 0x00000002
 #define IORING_SETUP_CQSIZE 0x00000008
 
+#define IORING_SQ_NEED_WAKEUP 0x00000001 /* in the sq ring flags */
+
 #define IORING_OP_POLL_ADD        6
 #define IORING_OP_POLL_REMOVE     7
+#define IORING_OP_SENDMSG         9
+#define IORING_OP_RECVMSG        10
 #define IORING_OP_TIMEOUT        11
 #define IORING_OP_TIMEOUT_REMOVE 12
+#define IORING_OP_ACCEPT         13
+#define IORING_OP_ASYNC_CANCEL   14
+#define IORING_OP_READ           22
+#define IORING_OP_WRITE          23
+#define IORING_OP_SEND           26
+#define IORING_OP_RECV           27
+#define IORING_OP_EPOLL_CTL      29
+
+/* struct iouring_kernel_timespec is defined in ev.c, as the loop needs one */
 
-/* relative or absolute, reference clock is CLOCK_MONOTONIC */
-struct iouring_kernel_timespec
+#define IORING_TIMEOUT_ABS 0x00000001
+
+/* 5.11+, passed instead of the sigmask with IORING_ENTER_EXT_ARG */
+struct io_uring_getevents_arg
 {
-  int64_t tv_sec;
-  long long tv_nsec;
+  __u64 sigmask;
+  __u32 sigmask_sz;
+  __u32 pad;
+  __u64 ts;
 };
 
-#define IORING_TIMEOUT_ABS 0x00000001
+struct io_uring_probe_op
+{
+  __u8 op;
+  __u8 resv;
+  __u16 flags;
+  __u32 resv2;
+};
+
+struct io_uring_probe
+{
+  __u8 last_op;
+  __u8 ops_len;
+  __u16 resv;
+  __u32 resv2[3];
+  struct io_uring_probe_op ops[256];
+};
+
+#define IO_URING_OP_SUPPORTED 0x0001
+
+#define IORING_POLL_ADD_MULTI 0x00000001 /* 5.13+, in sqe->len */
+
+#define IORING_CQE_F_MORE 0x00000002 /* more cqes will follow for this sqe */
+
+struct io_uring_files_update
+{
+  __u32 offset;
+  __u32 resv;
+  __u64 fds;
+};
+
+/* 5.19+ provided buffer rings, the tail overlays resv of the first entry */
+struct io_uring_buf
+{
+  __u64 addr;
+  __u32 len;
+  __u16 bid;
+  __u16 resv;
+};
+
+struct io_uring_buf_reg
+{
+  __u64 ring_addr;
+  __u32 ring_entries;
+  __u16 bgid;
+  __u16 flags;
+  __u64 resv[3];
+};
+
+#define IORING_REGISTER_FILES        2
+#define IORING_REGISTER_FILES_UPDATE 6
+#define IORING_REGISTER_PROBE        8
+#define IORING_REGISTER_PBUF_RING   22
+
+#define IOURING_MAX_FILES (1 << 20) /* current kernel limit, older kernels have lower ones */
 
 #define IORING_ENTER_GETEVENTS 0x01
+#define IORING_ENTER_SQ_WAKEUP 0x02
+#define IORING_ENTER_SQ_WAIT   0x04
+#define IORING_ENTER_EXT_ARG   0x08
 
 #define IORING_OFF_SQ_RING 0x00000000ULL
 #define IORING_OFF_CQ_RING 0x08000000ULL
@@ -197,6 +283,8 @@ struct iouring_kernel_timespec
 #define IORING_FEAT_SINGLE_MMAP   0x00000001
 #define IORING_FEAT_NODROP        0x00000002
 #define IORING_FEAT_SUBMIT_STABLE 0x00000004
+#define IORING_FEAT_SQPOLL_NONFIXED 0x00000080
+#define IORING_FEAT_EXT_ARG       0x00000100
 
 inline_size
 int
@@ -212,6 +300,13 @@ evsys_io_uring_enter (int fd, unsigned to_submit, unsigned min_complete, unsigne
   return ev_syscall6 (SYS_io_uring_enter, fd, to_submit, min_complete, flags, sig, sigsz);
 }
 
+inline_size
+int
+evsys_io_uring_register (int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+  return ev_syscall4 (SYS_io_uring_register, fd, opcode, arg, nr_args);
+}
+
 /*****************************************************************************/
 /* actual backed implementation */
 
@@ -226,16 +321,46 @@ evsys_io_uring_enter (int fd, unsigned to_submit, unsigned min_complete, unsigne
 #define EV_SQES         ((struct io_uring_sqe *)         iouring_sqes)
 #define EV_CQES         ((struct io_uring_cqe *)((char *)iouring_cq_ring + iouring_cq_cqes))
 
+/* user_data of our IORING_OP_TIMEOUT requests, see iouring_tfd_update */
+#define EV_IOURING_TIMEOUT_DATA ((uint64_t)-2)
+
 inline_speed
 int
 iouring_enter (EV_P_ ev_tstamp timeout)
 {
   int res;
+  unsigned flags = timeout > EV_TS_CONST (0.) ? IORING_ENTER_GETEVENTS : 0;
+
+  if (iouring_sqpoll)
+    {
+      /* the kernel thread submits on its own, it only needs a kick when it went to sleep */
+      ECB_MEMORY_FENCE; /* the tail update must be visible before we look at the flags */
+
+      if (EV_SQ_VAR (flags) & IORING_SQ_NEED_WAKEUP)
+        flags |= IORING_ENTER_SQ_WAKEUP;
+      else if (!flags)
+        {
+          iouring_to_submit = 0;
+          return 0;
+        }
+    }
 
   EV_RELEASE_CB;
 
-  res = evsys_io_uring_enter (iouring_fd, iouring_to_submit, 1,
-                              timeout > EV_TS_CONST (0.) ? IORING_ENTER_GETEVENTS : 0, 0, 0);
+  if (flags & IORING_ENTER_GETEVENTS && iouring_features & IORING_FEAT_EXT_ARG)
+    {
+      /* the kernel can bound the wait itself, no need for timerfds or timeout sqes */
+      struct iouring_kernel_timespec ts;
+      struct io_uring_getevents_arg arg = { 0 };
+
+      EV_TS_SET (ts, timeout);
+      arg.ts = (uint64_t)(uintptr_t)&ts;
+
+      res = evsys_io_uring_enter (iouring_fd, iouring_to_submit, 1,
+                                  flags | IORING_ENTER_EXT_ARG, (const sigset_t *)&arg, sizeof (arg));
+    }
+  else
+    res = evsys_io_uring_enter (iouring_fd, iouring_to_submit, 1, flags, 0, 0);
 
   assert (("libev: io_uring_enter did not consume all sqes", (res < 0 || res == iouring_to_submit)));
 
@@ -265,6 +390,15 @@ iouring_sqe_get (EV_P)
 
       /* queue full, need to flush and possibly handle some events */
 
+      /* with sqpoll, we wait for the kernel thread to make room (5.10+) */
+      if (iouring_sqpoll)
+        {
+          ECB_MEMORY_FENCE;
+
+          if (evsys_io_uring_enter (iouring_fd, 0, 0, IORING_ENTER_SQ_WAKEUP | IORING_ENTER_SQ_WAIT, 0, 0) >= 0)
+            continue;
+        }
+
 #if EV_FEATURE_CODE
       /* first we ask the kernel nicely, most often this frees up some sqes */
       int res = iouring_enter (EV_A_ EV_TS_CONST (0.));
@@ -283,7 +417,15 @@ iouring_sqe_get (EV_P)
 
   /*assert (("libev: io_uring queue full after flush", tail + 1 - EV_SQ_VAR (head) <= EV_SQ_VAR (ring_entries)));*/
 
-  return EV_SQES + (tail & EV_SQ_VAR (ring_mask));
+  {
+    struct io_uring_sqe *sqe = EV_SQES + (tail & EV_SQ_VAR (ring_mask));
+
+    /* sqes get reused for different opcodes, and the kernel rejects */
+    /* e.g. poll requests with stray off or len values, so start clean */
+    memset (sqe, 0, sizeof (*sqe));
+
+    return sqe;
+  }
 }
 
 inline_size
@@ -299,6 +441,499 @@ iouring_sqe_submit (EV_P_ struct io_uring_sqe *sqe)
   ++iouring_to_submit;
 }
 
+/*****************************************************************************/
+/* registered files, saving the kernel the fd lookup for every sqe */
+
+/* register a sparse file table (5.5+), with all currently watched fds in it */
+ecb_cold
+static void
+iouring_files_init (EV_P)
+{
+  struct rlimit rl;
+  unsigned int max, fd;
+  int *fds;
+
+  iouring_filemax     = 0;
+  iouring_filedropcnt = 0;
+
+  if (!(iouring_flags & EVFLAG_IOURING_FILES))
+    return;
+
+  /* the kernel limits the table size by RLIMIT_NOFILE, too */
+  max = getrlimit (RLIMIT_NOFILE, &rl) || rl.rlim_cur > IOURING_MAX_FILES ? IOURING_MAX_FILES : rl.rlim_cur;
+
+  ev_free (iouring_files);
+  iouring_files = (unsigned char *)ev_malloc (max);
+  fds = (int *)ev_malloc (max * sizeof (int));
+
+  for (fd = 0; fd < max; ++fd)
+    {
+      iouring_files [fd] = (int)fd < anfdmax && ANFD_head (fd);
+      fds [fd] = iouring_files [fd] ? (int)fd : -1;
+    }
+
+  while (evsys_io_uring_register (iouring_fd, IORING_REGISTER_FILES, fds, max) < 0)
+    {
+      if (errno == EBADF && memchr (iouring_files, 1, max))
+        {
+          /* some watched fd is bad, let the poll find out, and start empty */
+          memset (iouring_files, 0, max);
+
+          for (fd = 0; fd < max; ++fd)
+            fds [fd] = -1;
+        }
+      else if ((errno == EMFILE || errno == ENOMEM) && max > 1024)
+        max >>= 1; /* older kernels have lower limits */
+      else
+        {
+          /* no sparse tables, or some other problem, do without */
+          ev_free (iouring_files);
+          iouring_files = 0;
+          break;
+        }
+    }
+
+  if (iouring_files)
+    iouring_filemax = max;
+
+  ev_free (fds);
+}
+
+/* point the file table slot of the fd to it, or clear it */
+static void
+iouring_file_set (EV_P_ int fd, int add)
+{
+  struct io_uring_files_update up;
+  int value = add ? fd : -1;
+
+  up.offset = fd;
+  up.resv   = 0;
+  up.fds    = (uintptr_t)&value;
+
+  /* if that fails, we just use the fd as-is */
+  iouring_files [fd] = evsys_io_uring_register (iouring_fd, IORING_REGISTER_FILES_UPDATE, &up, 1) == 1 && add;
+}
+
+/* does an sqe the sqpoll thread has not consumed yet use the registered fd? */
+inline_size
+int
+iouring_file_queued (EV_P_ int fd)
+{
+  unsigned head = EV_SQ_VAR (head);
+  unsigned tail = EV_SQ_VAR (tail);
+  unsigned mask = EV_SQ_VAR (ring_mask);
+
+  for (; head != tail; ++head)
+    {
+      struct io_uring_sqe *sqe = EV_SQES + EV_SQ_ARRAY [head & mask];
+
+      if (sqe->fd == fd && sqe->flags & IOSQE_FIXED_FILE)
+        return 1;
+    }
+
+  return 0;
+}
+
+/* unregister the fds left over by iouring_file_update, once the sqpoll thread is past their sqes */
+static void
+iouring_file_drop (EV_P)
+{
+  if ((int)(EV_SQ_VAR (head) - iouring_filedrop_tail) < 0)
+    return;
+
+  while (iouring_filedropcnt)
+    {
+      int fd = iouring_filedrops [--iouring_filedropcnt];
+
+      /* it might have been registered again in the meantime */
+      if (iouring_files [fd] == 2)
+        iouring_file_set (EV_A_ fd, 0);
+    }
+}
+
+/* called from ev_io_start/ev_io_stop for the first and last watcher of an fd */
+static void
+iouring_file_update (EV_P_ int fd, int add)
+{
+  if ((unsigned int)fd >= iouring_filemax)
+    return;
+
+  if (add)
+    {
+      /* a pending unregistration still holds the old file, which the fd might not refer to anymore */
+      if (iouring_files [fd] != 1)
+        iouring_file_set (EV_A_ fd, 1);
+
+      return;
+    }
+
+  if (iouring_files [fd] != 1)
+    return;
+
+  /* queued sqes might still refer to the slot */
+  if (iouring_sqpoll)
+    {
+      /* the sqpoll thread consumes them asynchronously, and rather than waiting */
+      /* for it, we leave the slot to iouring_file_drop, called by iouring_poll */
+      if (EV_SQ_VAR (head) != EV_SQ_VAR (tail) && iouring_file_queued (EV_A_ fd))
+        {
+          iouring_files [fd] = 2;
+          array_needsize (int, iouring_filedrops, iouring_filedropmax, iouring_filedropcnt + 1, array_needsize_noinit);
+          iouring_filedrops [iouring_filedropcnt++] = fd;
+          iouring_filedrop_tail = EV_SQ_VAR (tail);
+          return;
+        }
+    }
+  else if (iouring_to_submit)
+    iouring_enter (EV_A_ EV_TS_CONST (0.));
+
+  iouring_file_set (EV_A_ fd, 0);
+}
+
+/* set the sqe fd, using the registered file if available */
+inline_speed
+void
+iouring_sqe_fd (EV_P_ struct io_uring_sqe *sqe, int fd)
+{
+  sqe->fd = fd;
+
+  /* not for fds waiting in iouring_filedrops, which must not gain new sqes */
+  if ((unsigned int)fd < iouring_filemax && iouring_files [fd] == 1)
+    sqe->flags |= IOSQE_FIXED_FILE;
+}
+
+/*****************************************************************************/
+/* provided buffer ring, the kernel picks a pool buffer when data arrives */
+
+#if EV_URING_ENABLE
+
+inline_speed
+void
+iouring_buf_provide (EV_P_ unsigned int bid)
+{
+  struct io_uring_buf *ring = (struct io_uring_buf *)iouring_bufring;
+  struct io_uring_buf *buf  = ring + (iouring_buftail & (uring_bufcnt - 1));
+
+  buf->addr = (uintptr_t)(uring_bufs + (size_t)bid * uring_bufsize);
+  buf->len  = uring_bufsize;
+  buf->bid  = bid;
+
+  ECB_MEMORY_FENCE_RELEASE;
+  *(volatile __u16 *)&ring->resv = ++iouring_buftail;
+}
+
+/* (re-)register the ring, and fill it with all buffers the user doesn't own */
+ecb_cold
+static int
+iouring_bufring_register (EV_P)
+{
+  struct io_uring_buf_reg reg = { 0 };
+  unsigned int bid;
+
+  reg.ring_addr    = (uintptr_t)iouring_bufring;
+  reg.ring_entries = uring_bufcnt;
+  reg.bgid         = 0;
+
+  if (evsys_io_uring_register (iouring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    return 0;
+
+  iouring_buftail = 0;
+  ((struct io_uring_buf *)iouring_bufring)->resv = 0;
+
+  for (bid = 0; bid < uring_bufcnt; ++bid)
+    if (!uring_bufout [bid])
+      iouring_buf_provide (EV_A_ bid);
+
+  return 1;
+}
+
+/* forget about the ring, the free buffers go back to the emulation */
+ecb_cold
+static void
+iouring_bufring_destroy (EV_P)
+{
+  if (!iouring_bufring)
+    return;
+
+  munmap (iouring_bufring, uring_bufcnt * sizeof (struct io_uring_buf));
+  iouring_bufring = 0;
+  uring_buf_reset (EV_A);
+}
+
+/* called by ev_uring_buffers, returns true if the kernel now owns the buffers */
+ecb_cold
+static int
+iouring_bufring_init (EV_P)
+{
+  /* needs to be page-aligned */
+  iouring_bufring = mmap (0, uring_bufcnt * sizeof (struct io_uring_buf), PROT_READ | PROT_WRITE,
+                          MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+
+  if (iouring_bufring == MAP_FAILED)
+    iouring_bufring = 0;
+  else if (!iouring_bufring_register (EV_A))
+    {
+      munmap (iouring_bufring, uring_bufcnt * sizeof (struct io_uring_buf));
+      iouring_bufring = 0;
+    }
+
+  return !!iouring_bufring;
+}
+
+#endif
+
+/*****************************************************************************/
+/* completion-based operations, used by ev_uring watchers */
+
+/* user_data of operations has bit 31 set, which no fd has, */
+/* the slot index in the remaining low bits and the slot generation in the high bits */
+#define EV_IOURING_OPFLAG 0x80000000U
+
+inline_size
+uint64_t
+iouring_op_user_data (EV_P_ int slot)
+{
+  return (uint32_t)slot | EV_IOURING_OPFLAG | ((uint64_t)iouring_ops [slot].gen << 32);
+}
+
+inline_size
+int
+iouring_op_alloc (EV_P_ void *w)
+{
+  int slot = iouring_opfree;
+
+  if (slot >= 0)
+    iouring_opfree = iouring_ops [slot].next;
+  else
+    {
+      slot = iouring_opcnt++;
+      array_needsize (ANURING, iouring_ops, iouring_opmax, iouring_opcnt, array_needsize_zerofill);
+    }
+
+  iouring_ops [slot].w = (W)w;
+
+  return slot;
+}
+
+/* the generation counter makes sure we ignore late completions */
+inline_size
+void
+iouring_op_free (EV_P_ int slot)
+{
+  iouring_ops [slot].w      = 0;
+  iouring_ops [slot].cancel = 0;
+  ++iouring_ops [slot].gen;
+  iouring_ops [slot].next = iouring_opfree;
+  iouring_opfree          = slot;
+}
+
+#if EV_URING_ENABLE
+
+static void
+iouring_op_submit (EV_P_ int slot)
+{
+  static const unsigned char opcodes [] = {
+    0,
+    IORING_OP_READ,   IORING_OP_WRITE,   IORING_OP_ACCEPT,
+    IORING_OP_RECV,   IORING_OP_SEND,
+    IORING_OP_RECVMSG, IORING_OP_SENDMSG
+  };
+
+  ev_uring *w = (ev_uring *)iouring_ops [slot].w;
+  struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
+
+  sqe->opcode    = opcodes [w->op];
+  sqe->addr      = (uintptr_t)w->buf;
+  sqe->user_data = iouring_op_user_data (EV_A_ slot);
+  iouring_sqe_fd (EV_A_ sqe, w->fd);
+
+  switch (w->op)
+    {
+      case EV_URING_READ:
+      case EV_URING_WRITE:
+        sqe->off      = w->off; /* -1 means current file position */
+        sqe->len      = w->len;
+        sqe->rw_flags = w->flags;
+        break;
+
+      case EV_URING_ACCEPT:
+        sqe->addr2        = w->buf ? (uintptr_t)&w->len : 0;
+        sqe->accept_flags = w->flags;
+        break;
+
+      case EV_URING_RECV:
+      case EV_URING_SEND:
+        sqe->len       = w->len;
+        sqe->msg_flags = w->flags;
+        break;
+
+      default: /* recvmsg, sendmsg */
+        sqe->len       = 1;
+        sqe->msg_flags = w->flags;
+        break;
+    }
+
+  /* let the kernel pick a buffer once data arrives */
+  if (uring_pooled (EV_A_ w))
+    {
+      sqe->len       = uring_bufsize;
+      sqe->flags    |= IOSQE_BUFFER_SELECT;
+      sqe->buf_group = 0;
+    }
+
+  iouring_sqe_submit (EV_A_ sqe);
+}
+
+#endif
+
+#if EV_URING_ENABLE
+
+/* cancel an in-flight operation. the kernel might or might not succeed, */
+/* and until the operation itself completes, it might still write into */
+/* the buffer (and, for accept, into w->len), so we keep the slot and */
+/* mark the watcher busy until that completion arrives */
+static void
+iouring_op_cancel (EV_P_ int slot)
+{
+  ev_uring *w = (ev_uring *)iouring_ops [slot].w;
+  struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
+
+  sqe->opcode    = IORING_OP_ASYNC_CANCEL;
+  sqe->addr      = iouring_op_user_data (EV_A_ slot);
+  sqe->user_data = (uint64_t)-1;
+  iouring_sqe_submit (EV_A_ sqe);
+
+  w->wflags |= EV__WF_BUSY;
+  iouring_ops [slot].cancel = (W)w;
+  iouring_ops [slot].w      = 0;
+}
+
+/* the kernel is done with a cancelled operation, give the buffer back to the user */
+static void
+iouring_op_cancelled (EV_P_ int slot, int res)
+{
+  ev_uring *w = (ev_uring *)iouring_ops [slot].cancel;
+
+  /* the cancel came too late for an accept, so nobody wants this connection */
+  if (w->op == EV_URING_ACCEPT && res >= 0)
+    {
+      close (res);
+      res = -ECANCELED;
+    }
+
+  w->res     = res;
+  w->wflags &= ~EV__WF_BUSY;
+  iouring_op_free (EV_A_ slot);
+}
+
+#endif
+
+/* the ring goes away (after a fork, a switch to another backend or on loop */
+/* destruction), and with it, all outstanding cancelled operations */
+ecb_cold
+static void
+iouring_op_cancelled_all (EV_P)
+{
+#if EV_URING_ENABLE
+  int slot;
+
+  for (slot = 0; slot < iouring_opcnt; ++slot)
+    if (iouring_ops [slot].cancel)
+      iouring_op_cancelled (EV_A_ slot, -ECANCELED);
+#endif
+}
+
+/* after a fork, the new ring knows nothing about our operations, so resubmit them */
+ecb_cold
+static void
+iouring_op_rearm_all (EV_P)
+{
+#if EV_URING_ENABLE
+  int slot;
+
+  /* the new ring will not complete cancelled operations */
+  iouring_op_cancelled_all (EV_A);
+
+  for (slot = 0; slot < iouring_opcnt; ++slot)
+    if (iouring_ops [slot].w)
+      {
+        ev_uring *w = (ev_uring *)iouring_ops [slot].w;
+
+        /* we might have lost the buffer ring */
+        if (!iouring_bufring && uring_pooled (EV_A_ w))
+          {
+            iouring_op_free (EV_A_ slot);
+            uring_emulate (EV_A_ w);
+            continue;
+          }
+
+        ++iouring_ops [slot].gen;
+        iouring_op_submit (EV_A_ slot);
+      }
+#endif
+}
+
+/* we are switching backends, so let the readiness-based emulation take over */
+ecb_cold
+static void
+iouring_op_emulate_all (EV_P)
+{
+#if EV_URING_ENABLE
+  int slot;
+
+  iouring_op_cancelled_all (EV_A);
+
+  for (slot = 0; slot < iouring_opcnt; ++slot)
+    if (iouring_ops [slot].w)
+      {
+        ev_uring *w = (ev_uring *)iouring_ops [slot].w;
+
+        iouring_op_free (EV_A_ slot);
+        uring_emulate (EV_A_ w);
+      }
+#endif
+
+  ev_free (iouring_ops); iouring_ops = 0; iouring_opcnt = iouring_opmax = 0;
+  iouring_opfree = -1;
+}
+
+inline_size
+void
+iouring_process_op_cqe (EV_P_ struct io_uring_cqe *cqe)
+{
+  int      slot = cqe->user_data & ~EV_IOURING_OPFLAG & 0xffffffffU;
+  uint32_t gen  = cqe->user_data >> 32;
+
+  assert (("libev: io_uring operation slot must be in-bounds", slot >= 0 && slot < iouring_opcnt));
+
+  /* ignore completions of cancelled or restarted operations, */
+  /* but don't lose the buffer the kernel might have picked for it */
+  if (ecb_expect_false (gen != iouring_ops [slot].gen || !iouring_ops [slot].w))
+    {
+#if EV_URING_ENABLE
+      if (cqe->flags & IORING_CQE_F_BUFFER && iouring_bufring)
+        iouring_buf_provide (EV_A_ cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+      if (gen == iouring_ops [slot].gen && iouring_ops [slot].cancel)
+        iouring_op_cancelled (EV_A_ slot, cqe->res);
+#endif
+      return;
+    }
+
+#if EV_URING_ENABLE
+  {
+    ev_uring *w = (ev_uring *)iouring_ops [slot].w;
+
+    iouring_op_free (EV_A_ slot);
+
+    if (cqe->flags & IORING_CQE_F_BUFFER)
+      uring_buf_take (EV_A_ w, cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+
+    uring_done (EV_A_ w, cqe->res);
+  }
+#endif
+}
+
 /*****************************************************************************/
 
 /* when the timerfd expires we simply note the fact,
@@ -308,7 +943,21 @@ iouring_sqe_submit (EV_P_ struct io_uring_sqe *sqe)
 static void
 iouring_tfd_cb (EV_P_ struct ev_io *w, int revents)
 {
-  iouring_tfd_to = EV_TSTAMP_HUGE;
+  iouring_tfd_to = EV_TS_CONST (EV_TSTAMP_HUGE);
+}
+
+/* start the timerfd watcher, if we need a timerfd at all */
+ecb_cold
+static void
+iouring_tfd_start (EV_P)
+{
+  if (iouring_tfd < 0)
+    return;
+
+  ev_io_init  (&iouring_tfd_w, iouring_tfd_cb, iouring_tfd, EV_READ);
+  ev_set_priority (&iouring_tfd_w, EV_MINPRI);
+  ev_io_start (EV_A_ &iouring_tfd_w);
+  ev_unref (EV_A); /* watcher should not keep loop alive */
 }
 
 /* called for full and partial cleanup */
@@ -316,18 +965,97 @@ ecb_cold
 static int
 iouring_internal_destroy (EV_P)
 {
-  close (iouring_tfd);
-  close (iouring_fd);
-
-  if (iouring_sq_ring != MAP_FAILED) munmap (iouring_sq_ring, iouring_sq_ring_size);
-  if (iouring_cq_ring != MAP_FAILED) munmap (iouring_cq_ring, iouring_cq_ring_size);
-  if (iouring_sqes    != MAP_FAILED) munmap (iouring_sqes   , iouring_sqes_size   );
+  /* the file table goes away with the ring, and after a fork, */
+  /* we must not touch the table of the parent */
+  iouring_filemax = 0;
 
+  /* stop the watcher first, the fd must still be valid for that */
   if (ev_is_active (&iouring_tfd_w))
     {
       ev_ref (EV_A);
       ev_io_stop (EV_A_ &iouring_tfd_w);
     }
+
+  if (iouring_tfd >= 0)
+    close (iouring_tfd);
+
+  close (iouring_fd);
+
+  if (iouring_sq_ring != MAP_FAILED) munmap (iouring_sq_ring, iouring_sq_ring_size);
+  if (iouring_cq_ring != MAP_FAILED) munmap (iouring_cq_ring, iouring_cq_ring_size);
+  if (iouring_sqes    != MAP_FAILED) munmap (iouring_sqes   , iouring_sqes_size   );
+}
+
+/* multishot polls (5.13+) are rejected with EINVAL by older kernels, */
+/* and there is no feature flag, so we try one on an idle pipe. */
+/* everything uses user_data -1, so stray completions get ignored later. */
+ecb_cold
+static int
+iouring_probe_multishot (EV_P)
+{
+  int fds [2];
+  int ok = 1;
+  unsigned head, tail, mask;
+  struct io_uring_sqe *sqe;
+
+  if (pipe (fds) < 0)
+    return 0;
+
+  sqe = iouring_sqe_get (EV_A);
+  sqe->opcode      = IORING_OP_POLL_ADD;
+  sqe->fd          = fds [0];
+  sqe->len         = IORING_POLL_ADD_MULTI;
+  sqe->poll_events = POLLIN;
+  sqe->user_data   = (uint64_t)-1;
+  iouring_sqe_submit (EV_A_ sqe);
+
+  sqe = iouring_sqe_get (EV_A);
+  sqe->opcode      = IORING_OP_POLL_REMOVE;
+  sqe->fd          = fds [0];
+  sqe->addr        = (uint64_t)-1;
+  sqe->user_data   = (uint64_t)-1;
+  iouring_sqe_submit (EV_A_ sqe);
+
+  while (evsys_io_uring_enter (iouring_fd, iouring_to_submit, 2, IORING_ENTER_GETEVENTS | IORING_ENTER_SQ_WAKEUP, 0, 0) < 0)
+    if (errno != EINTR)
+      {
+        ok = 0;
+        break;
+      }
+
+  iouring_to_submit = 0;
+
+  head = EV_CQ_VAR (head);
+  ECB_MEMORY_FENCE_ACQUIRE;
+  tail = EV_CQ_VAR (tail);
+  mask = EV_CQ_VAR (ring_mask);
+
+  for (; head != tail; ++head)
+    if (EV_CQES [head & mask].res == -EINVAL)
+      ok = 0;
+
+  EV_CQ_VAR (head) = head;
+  ECB_MEMORY_FENCE_RELEASE;
+
+  close (fds [0]);
+  close (fds [1]);
+
+  return ok;
+}
+
+/* check whether the kernel supports the given opcode, needs 5.6+ */
+ecb_cold
+static int
+iouring_probe_op (EV_P_ int op)
+{
+  struct io_uring_probe probe;
+
+  memset (&probe, 0, sizeof (probe));
+
+  if (evsys_io_uring_register (iouring_fd, IORING_REGISTER_PROBE, &probe, sizeof (probe.ops) / sizeof (probe.ops [0])) < 0)
+    return 0;
+
+  return op <= probe.last_op && probe.ops [op].flags & IO_URING_OP_SUPPORTED;
 }
 
 ecb_cold
@@ -346,12 +1074,40 @@ iouring_internal_init (EV_P)
   if (!have_monotonic) /* cannot really happen, but what if11 */
     return -1;
 
+  iouring_sqpoll = !!(iouring_flags & EVFLAG_IOURING_SQPOLL);
+
   for (;;)
     {
+      if (iouring_sqpoll)
+        {
+          params.flags          |= IORING_SETUP_SQPOLL;
+          params.sq_thread_idle  = EV_IOURING_SQPOLL_IDLE;
+        }
+      else
+        params.flags          &= ~IORING_SETUP_SQPOLL;
+
       iouring_fd = evsys_io_uring_setup (iouring_entries, &params);
 
       if (iouring_fd >= 0)
-        break; /* yippie */
+        {
+          /* before 5.11, sqpoll only worked with registered files, so we do without */
+          if (iouring_sqpoll && !(params.features & IORING_FEAT_SQPOLL_NONFIXED))
+            {
+              close (iouring_fd);
+              memset (&params, 0, sizeof (params));
+              iouring_sqpoll = 0;
+              continue;
+            }
+
+          break; /* yippie */
+        }
+
+      /* sqpoll needed privileges before 5.11 */
+      if (iouring_sqpoll && errno == EPERM)
+        {
+          iouring_sqpoll = 0;
+          continue;
+        }
 
       if (errno != EINVAL)
         return -1; /* we failed */
@@ -403,13 +1159,20 @@ iouring_internal_init (EV_P)
   iouring_cq_overflow     = params.cq_off.overflow;
   iouring_cq_cqes         = params.cq_off.cqes;
 
+  iouring_features        = params.features;
+  iouring_tfd_to          = EV_TS_CONST (EV_TSTAMP_HUGE);
+  iouring_multishot       = iouring_probe_multishot (EV_A) ? IORING_POLL_ADD_MULTI : 0;
+
+  /* we bound the wait either with an extended io_uring_enter (5.11+), */
+  /* an absolute IORING_OP_TIMEOUT (5.6+) or, failing that, a timerfd */
+  if (iouring_features & IORING_FEAT_EXT_ARG || iouring_probe_op (EV_A_ IORING_OP_TIMEOUT))
+    return 0;
+
   iouring_tfd = timerfd_create (CLOCK_MONOTONIC, TFD_CLOEXEC);
 
   if (iouring_tfd < 0)
     return iouring_tfd;
 
-  iouring_tfd_to = EV_TSTAMP_HUGE;
-
   return 0;
 }
 
@@ -422,11 +1185,17 @@ iouring_fork (EV_P)
   while (iouring_internal_init (EV_A) < 0)
     ev_syserr ("(libev) io_uring_setup");
 
+  iouring_files_init (EV_A);
+
+#if EV_URING_ENABLE
+  if (iouring_bufring && !iouring_bufring_register (EV_A))
+    iouring_bufring_destroy (EV_A);
+#endif
+
   fd_rearm_all (EV_A);
+  iouring_op_rearm_all (EV_A);
 
-  ev_io_stop  (EV_A_ &iouring_tfd_w);
-  ev_io_set   (EV_A_ &iouring_tfd_w, iouring_tfd, EV_READ);
-  ev_io_start (EV_A_ &iouring_tfd_w);
+  iouring_tfd_start (EV_A);
 }
 
 /*****************************************************************************/
@@ -436,7 +1205,6 @@ iouring_modify (EV_P_ int fd, int oev, int nev)
 {
   if (oev)
     {
-      /* we assume the sqe's are all "properly" initialised */
       struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
       sqe->opcode    = IORING_OP_POLL_REMOVE;
       sqe->fd        = fd;
@@ -445,24 +1213,30 @@ iouring_modify (EV_P_ int fd, int oev, int nev)
        * be removed. Since we don't *really* have that, we pass in the old
        * generation counter - if that fails, too bad, it will hopefully be removed
        * at close time and then be ignored. */
-      sqe->addr      = (uint32_t)fd | ((__u64)(uint32_t)anfds [fd].egen << 32);
+      sqe->addr      = (uint32_t)fd | ((__u64)(uint32_t)ANFD_at (fd).egen << 32);
       sqe->user_data = (uint64_t)-1;
       iouring_sqe_submit (EV_A_ sqe);
 
       /* increment generation counter to avoid handling old events */
-      ++anfds [fd].egen;
+      ++ANFD_at (fd).egen;
     }
 
   if (nev)
     {
       struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
       sqe->opcode      = IORING_OP_POLL_ADD;
-      sqe->fd          = fd;
       sqe->addr        = 0;
-      sqe->user_data   = (uint32_t)fd | ((__u64)(uint32_t)anfds [fd].egen << 32);
+      iouring_sqe_fd (EV_A_ sqe, fd);
+      sqe->user_data   = (uint32_t)fd | ((__u64)(uint32_t)ANFD_at (fd).egen << 32);
       sqe->poll_events =
         (nev & EV_READ ? POLLIN : 0)
         | (nev & EV_WRITE ? POLLOUT : 0);
+
+      /* multishot polls only report state changes, so we can only use them */
+      /* when the watchers asked for edge-triggered notifications */
+      if (nev & EV_EDGE)
+        sqe->len = iouring_multishot;
+
       iouring_sqe_submit (EV_A_ sqe);
     }
 }
@@ -479,14 +1253,47 @@ iouring_tfd_update (EV_P_ ev_tstamp timeout)
    */
   if (ecb_expect_false (tfd_to < iouring_tfd_to))
     {
-       struct itimerspec its;
-
        iouring_tfd_to = tfd_to;
-       EV_TS_SET (its.it_interval, 0.);
-       EV_TS_SET (its.it_value, tfd_to);
 
-       if (timerfd_settime (iouring_tfd, TFD_TIMER_ABSTIME, &its, 0) < 0)
-         assert (("libev: iouring timerfd_settime failed", 0));
+       if (iouring_tfd < 0)
+         {
+           /* queue an absolute timeout instead, it is submitted together */
+           /* with the next io_uring_enter, so costs no extra syscall. */
+           /* the sqe is copied on submit, but the timespec is not, hence the loop var */
+           struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
+
+           /* remove the timeout we queued before, if it is still outstanding, */
+           /* so that only one ever is. we cannot know for sure, as its expiry */
+           /* might be in flight, so always try, and ignore the -ENOENT */
+           sqe->opcode    = IORING_OP_TIMEOUT_REMOVE;
+           sqe->fd        = -1;
+           sqe->addr      = EV_IOURING_TIMEOUT_DATA;
+           sqe->user_data = (uint64_t)-1;
+           iouring_sqe_submit (EV_A_ sqe);
+
+           sqe = iouring_sqe_get (EV_A);
+
+           EV_TS_SET (iouring_timeout_ts, tfd_to);
+
+           sqe->opcode        = IORING_OP_TIMEOUT;
+           sqe->fd            = -1;
+           sqe->addr          = (uint64_t)(uintptr_t)&iouring_timeout_ts;
+           sqe->len           = 1;
+           sqe->off           = 0; /* only complete on expiry */
+           sqe->timeout_flags = IORING_TIMEOUT_ABS;
+           sqe->user_data     = EV_IOURING_TIMEOUT_DATA;
+           iouring_sqe_submit (EV_A_ sqe);
+         }
+       else
+         {
+           struct itimerspec its;
+
+           EV_TS_SET (its.it_interval, EV_TS_CONST (0.));
+           EV_TS_SET (its.it_value, tfd_to);
+
+           if (timerfd_settime (iouring_tfd, TFD_TIMER_ABSTIME, &its, 0) < 0)
+             assert (("libev: iouring timerfd_settime failed", 0));
+         }
     }
 }
 
@@ -502,6 +1309,22 @@ iouring_process_cqe (EV_P_ struct io_uring_cqe *cqe)
   if (cqe->user_data == (uint64_t)-1)
     return;
 
+  /* like the timerfd, an expired timeout just woke us up, nothing else, */
+  /* and a removed one was replaced by a new one, see iouring_tfd_update */
+  if (ecb_expect_false (cqe->user_data == EV_IOURING_TIMEOUT_DATA))
+    {
+      if (res != -ECANCELED)
+        iouring_tfd_to = EV_TS_CONST (EV_TSTAMP_HUGE);
+
+      return;
+    }
+
+  if (ecb_expect_false ((uint32_t)cqe->user_data & EV_IOURING_OPFLAG))
+    {
+      iouring_process_op_cqe (EV_A_ cqe);
+      return;
+    }
+
   assert (("libev: io_uring fd must be in-bounds", fd >= 0 && fd < anfdmax));
 
   /* documentation lies, of course. the result value is NOT like
@@ -513,7 +1336,7 @@ iouring_process_cqe (EV_P_ struct io_uring_cqe *cqe)
   /* ignore event if generation doesn't match */
   /* other than skipping removal events, */
   /* this should actually be very rare */
-  if (ecb_expect_false (gen != (uint32_t)anfds [fd].egen))
+  if (ecb_expect_false (gen != (uint32_t)ANFD_at (fd).egen))
     return;
 
   if (ecb_expect_false (res < 0))
@@ -542,9 +1365,14 @@ iouring_process_cqe (EV_P_ struct io_uring_cqe *cqe)
     | (res & (POLLIN | POLLERR | POLLHUP) ? EV_READ : 0)
   );
 
-  /* io_uring is oneshot, so we need to re-arm the fd next iteration */
+  /* a multishot poll stays armed for as long as the kernel sets IORING_CQE_F_MORE */
+  if (ecb_expect_true (cqe->flags & IORING_CQE_F_MORE))
+    return;
+
+  /* io_uring is oneshot (or the kernel dropped our multishot poll), */
+  /* so we need to re-arm the fd next iteration */
   /* this also means we usually have to do at least one syscall per iteration */
-  anfds [fd].events = 0;
+  ANFD_at (fd).events = 0;
   fd_change (EV_A_ fd, EV_ANFD_REIFY);
 }
 
@@ -585,6 +1413,9 @@ iouring_overflow (EV_P)
 
       /* this should make it so that on return, we don't call any uring functions */
       iouring_to_submit = 0;
+#if EV_URING_ENABLE
+      iouring_bufring_destroy (EV_A);
+#endif
 
       for (;;)
         {
@@ -595,6 +1426,8 @@ iouring_overflow (EV_P)
 
           ev_syserr ("(libev) iouring switch to epoll");
         }
+
+      iouring_op_emulate_all (EV_A);
     }
 }
 
@@ -638,10 +1471,14 @@ iouring_poll (EV_P_ ev_tstamp timeout)
   /* the latter should only happen if both the sq and cq are full, most likely */
   /* because we have a lot of event sources that immediately complete */
   /* TODO: fdchacngecnt is always 0 because fd_reify does not have two buffers yet */
+  /* don't keep the files of stopped fds open for long, the sqpoll thread is almost done with them */
+  if (ecb_expect_false (iouring_filedropcnt) && timeout > EV_TS_CONST (1e-3))
+    timeout = EV_TS_CONST (1e-3);
+
   if (iouring_handle_cq (EV_A) || fdchangecnt)
     timeout = EV_TS_CONST (0.);
-  else
-    /* no events, so maybe wait for some */
+  else if (timeout && !(iouring_features & IORING_FEAT_EXT_ARG))
+    /* no events, so maybe wait for some, unless io_uring_enter can bound the wait itself */
     iouring_tfd_update (EV_A_ timeout);
 
   /* only enter the kernel if we have something to submit, or we need to wait */
@@ -650,8 +1487,8 @@ iouring_poll (EV_P_ ev_tstamp timeout)
       int res = iouring_enter (EV_A_ timeout);
 
       if (ecb_expect_false (res < 0))
-        if (errno == EINTR)
-          /* ignore */;
+        if (errno == EINTR || errno == ETIME)
+          /* ignore, ETIME means the IORING_ENTER_EXT_ARG timeout expired */;
         else if (errno == EBUSY)
           /* cq full, cannot submit - should be rare because we flush the cq first, so simply ignore */;
         else
@@ -659,14 +1496,19 @@ iouring_poll (EV_P_ ev_tstamp timeout)
       else
         iouring_handle_cq (EV_A);
     }
+
+  if (ecb_expect_false (iouring_filedropcnt))
+    iouring_file_drop (EV_A);
 }
 
 inline_size
 int
 iouring_init (EV_P_ int flags)
 {
+  iouring_flags       = flags;
   iouring_entries     = IOURING_INIT_ENTRIES;
   iouring_max_entries = 0;
+  iouring_opfree      = -1;
 
   if (iouring_internal_init (EV_A) < 0)
     {
@@ -674,10 +1516,8 @@ iouring_init (EV_P_ int flags)
       return 0;
     }
 
-  ev_io_init  (&iouring_tfd_w, iouring_tfd_cb, iouring_tfd, EV_READ);
-  ev_set_priority (&iouring_tfd_w, EV_MINPRI);
-  ev_io_start (EV_A_ &iouring_tfd_w);
-  ev_unref (EV_A); /* watcher should not keep loop alive */
+  iouring_files_init (EV_A);
+  iouring_tfd_start (EV_A);
 
   backend_modify = iouring_modify;
   backend_poll   = iouring_poll;
@@ -690,5 +1530,96 @@ void
 iouring_destroy (EV_P)
 {
   iouring_internal_destroy (EV_A);
+  iouring_op_cancelled_all (EV_A);
+  ev_free (iouring_ops); iouring_ops = 0; iouring_opcnt = iouring_opmax = 0;
+  ev_free (iouring_files); iouring_files = 0; iouring_filemax = 0;
+  ev_free (iouring_filedrops); iouring_filedrops = 0; iouring_filedropmax = iouring_filedropcnt = 0;
+#if EV_URING_ENABLE
+  iouring_bufring_destroy (EV_A);
+#endif
+}
+
+/*****************************************************************************/
+/* batched epoll_ctl calls for the epoll backend, see EVFLAG_EPOLL_BATCH */
+
+/* the epoll backend only uses the ring for submission, nothing else */
+ecb_cold
+static int
+iouring_epoll_init (EV_P)
+{
+  iouring_flags       = 0;
+  iouring_entries     = IOURING_INIT_ENTRIES;
+  iouring_max_entries = 0;
+
+  if (iouring_internal_init (EV_A) < 0 || !iouring_probe_op (EV_A_ IORING_OP_EPOLL_CTL))
+    {
+      iouring_internal_destroy (EV_A);
+      return 0;
+    }
+
+  return 1;
 }
 
+/* submit all changes and wait for all of their completions, */
+/* as many as fit into the ring at a time */
+static void
+iouring_epoll_ctl (EV_P_ struct epoll_change *changes, int cnt)
+{
+  while (cnt)
+    {
+      int i, done;
+      int n = cnt < (int)EV_SQ_VAR (ring_entries) ? cnt : (int)EV_SQ_VAR (ring_entries);
+
+      for (i = 0; i < n; ++i)
+        {
+          struct io_uring_sqe *sqe = iouring_sqe_get (EV_A);
+
+          /* the kernel copies the epoll_event when it picks up the sqe */
+          sqe->opcode    = IORING_OP_EPOLL_CTL;
+          sqe->fd        = backend_fd;
+          sqe->off       = changes [i].fd;
+          sqe->len       = changes [i].op;
+          sqe->addr      = (uint64_t)(uintptr_t)&changes [i].ev;
+          sqe->user_data = i;
+          iouring_sqe_submit (EV_A_ sqe);
+        }
+
+      for (done = 0; done < n; )
+        {
+          unsigned head, tail, mask;
+
+          if (evsys_io_uring_enter (iouring_fd, iouring_to_submit, n - done, IORING_ENTER_GETEVENTS, 0, 0) < 0)
+            {
+              if (errno != EINTR)
+                ev_syserr ("(libev) io_uring_enter");
+
+              continue;
+            }
+
+          iouring_to_submit = 0;
+
+          head = EV_CQ_VAR (head);
+          ECB_MEMORY_FENCE_ACQUIRE;
+          tail = EV_CQ_VAR (tail);
+          mask = EV_CQ_VAR (ring_mask);
+
+          for (; head != tail; ++head)
+            {
+              struct io_uring_cqe *cqe = EV_CQES + (head & mask);
+
+              /* there might be leftovers from iouring_probe_multishot */
+              if (cqe->user_data < (uint64_t)n)
+                {
+                  changes [cqe->user_data].res = cqe->res;
+                  ++done;
+                }
+            }
+
+          EV_CQ_VAR (head) = head;
+          ECB_MEMORY_FENCE_RELEASE;
+        }
+
+      changes += n;
+      cnt     -= n;
+    }
+}
@@ -120,14 +120,14 @@ kqueue_poll (EV_P_ ev_tstamp timeout)
           int err = kqueue_events [i].data;
 
           /* we are only interested in errors for fds that we are interested in :) */
-          if (anfds [fd].events)
+          if (ANFD_at (fd).events)
             {
               if (err == ENOENT) /* resubmit changes on ENOENT */
-                kqueue_modify (EV_A_ fd, 0, anfds [fd].events);
+                kqueue_modify (EV_A_ fd, 0, ANFD_at (fd).events);
               else if (err == EBADF) /* on EBADF, we re-check the fd */
                 {
                   if (fd_valid (fd))
-                    kqueue_modify (EV_A_ fd, 0, anfds [fd].events);
+                    kqueue_modify (EV_A_ fd, 0, ANFD_at (fd).events);
                   else
                     {
                       assert (("libev: kqueue found invalid fd", 0));
@@ -235,7 +235,7 @@ linuxaio_modify (EV_P_ int fd, int oev, int nev)
 {
   array_needsize (ANIOCBP, linuxaio_iocbps, linuxaio_iocbpmax, fd + 1, linuxaio_array_needsize_iocbp);
   ANIOCBP iocb = linuxaio_iocbps [fd];
-  ANFD *anfd = &anfds [fd];
+  ANFD *anfd = &ANFD_at (fd);
 
   if (ecb_expect_false (iocb->io.aio_reqprio < 0))
     {
@@ -295,7 +295,7 @@ inline_speed
 void
 linuxaio_fd_rearm (EV_P_ int fd)
 {
-  anfds [fd].events = 0;
+  ANFD_at (fd).events = 0;
   linuxaio_iocbps [fd]->io.aio_buf = 0;
   fd_change (EV_A_ fd, EV_ANFD_REIFY);
 }
@@ -312,7 +312,7 @@ linuxaio_parse_events (EV_P_ struct io_event *ev, int nr)
       assert (("libev: iocb fd must be in-bounds", fd >= 0 && fd < anfdmax));
 
       /* only accept events if generation counter matches */
-      if (ecb_expect_true (gen == (uint32_t)anfds [fd].egen))
+      if (ecb_expect_true (gen == (uint32_t)ANFD_at (fd).egen))
         {
           /* feed events, we do not expect or handle POLLNVAL */
           fd_event (
@@ -475,7 +475,7 @@ linuxaio_poll (EV_P_ ev_tstamp timeout)
              * fails but POLLIN|POLLOUT works.
              */
             struct iocb *iocb = linuxaio_submits [submitted];
-            epoll_modify (EV_A_ iocb->aio_fildes, 0, anfds [iocb->aio_fildes].events);
+            epoll_modify (EV_A_ iocb->aio_fildes, 0, ANFD_at (iocb->aio_fildes).events);
             iocb->aio_reqprio = -1; /* mark iocb as epoll */
 
             res = 1; /* skip this iocb - another iocb, another chance */
@@ -39,6 +39,15 @@
 
 #include <poll.h>
 
+#if EV_USE_PPOLL
+/* the raw ppoll syscall takes the kernel's own, long-based timespec */
+struct ppoll_kernel_timespec
+{
+  long tv_sec;
+  long tv_nsec;
+};
+#endif
+
 inline_size
 void
 array_needsize_pollidx (int *base, int offset, int count)
@@ -95,7 +104,17 @@ poll_poll (EV_P_ ev_tstamp timeout)
   int res;
   
   EV_RELEASE_CB;
+#if EV_USE_PPOLL
+  {
+    /* nanosecond timeouts, where poll would round up to milliseconds */
+    struct ppoll_kernel_timespec ts;
+
+    EV_TS_SET (ts, timeout);
+    res = ev_syscall5 (SYS_ppoll, polls, pollcnt, &ts, 0, 0);
+  }
+#else
   res = poll (polls, pollcnt, EV_TS_TO_MSEC (timeout));
+#endif
   EV_ACQUIRE_CB;
 
   if (ecb_expect_false (res < 0))
@@ -136,7 +155,7 @@ inline_size
 int
 poll_init (EV_P_ int flags)
 {
-  backend_mintime = EV_TS_CONST (1e-3);
+  backend_mintime = EV_USE_PPOLL ? EV_TS_CONST (1e-9) : EV_TS_CONST (1e-3);
   backend_modify  = poll_modify;
   backend_poll    = poll_poll;
 
@@ -77,7 +77,7 @@ select_modify (EV_P_ int fd, int oev, int nev)
 #if EV_SELECT_USE_FD_SET
 
     #if EV_SELECT_IS_WINSOCKET
-    SOCKET handle = anfds [fd].handle;
+    SOCKET handle = ANFD_handle (fd);
     #else
     int handle = fd;
     #endif
@@ -221,11 +221,11 @@ select_poll (EV_P_ ev_tstamp timeout)
     int fd;
 
     for (fd = 0; fd < anfdmax; ++fd)
-      if (anfds [fd].events)
+      if (ANFD_at (fd).events)
         {
           int events = 0;
           #if EV_SELECT_IS_WINSOCKET
-          SOCKET handle = anfds [fd].handle;
+          SOCKET handle = ANFD_handle (fd);
           #else
           int handle = fd;
           #endif
@@ -43,6 +43,20 @@ VARx(ev_tstamp, now_floor) /* last time we refreshed rt_time */
 VARx(ev_tstamp, mn_now)    /* monotonic clock "now" */
 VARx(ev_tstamp, rtmn_diff) /* difference realtime - monotonic time */
 
+#if EV_CLOCK_POLICY || EV_GENWRAP
+VARx(unsigned char, clock_policy) /* 0, or the cheaper clock standing in for the monotonic one */
+VARx(ev_tstamp, clock_res)        /* resolution of the coarse clock, the minimum wait time */
+VARx(ev_tstamp, clock_maxdrift)   /* largest difference to the monotonic clock found so far */
+VARx(unsigned long, clock_resynccnt)
+#endif
+#if EV_USE_TSC || EV_GENWRAP
+VARx(uint64_t, tsc_base)    /* tsc at the last resync */
+VARx(ev_tstamp, tsc_mono)   /* loop clock at tsc_base */
+VARx(double, tsc_scale)     /* clock units per tick, 0 while still calibrating */
+VARx(uint64_t, tsc_cal)     /* tsc when calibration started */
+VARx(ev_tstamp, tsc_calmono) /* monotonic clock when calibration started */
+#endif
+
 /* for reverse feeding of events */
 VARx(W *, rfeeds)
 VARx(int, rfeedmax)
@@ -57,6 +71,15 @@ VARx(ev_prepare, pending_w) /* dummy pending watcher */
 VARx(ev_tstamp, io_blocktime)
 VARx(ev_tstamp, timeout_blocktime)
 
+VARx(ev_tstamp, busypoll_budget) /* maximum spin time before blocking, 0 if not busy-polling */
+#if EV_USE_EPOLL || EV_GENWRAP
+VARx(ev_tstamp, busypoll_window) /* current spin time, adapted to the event rate */
+VARx(ev_tstamp, busypoll_gap)    /* average time between events */
+VARx(ev_tstamp, busypoll_last)   /* time of the last event */
+VARx(unsigned int, busypoll_spins) /* number of times we spun before blocking */
+VARx(unsigned int, busypoll_hits)  /* number of spins that found events */
+#endif
+
 VARx(int, backend)
 VARx(int, activecnt) /* total number of active events ("refcount") */
 VARx(EV_ATOMIC_T, loop_done)  /* signal by ev_break */
@@ -66,8 +89,16 @@ VARx(ev_tstamp, backend_mintime) /* assumed typical timer resolution */
 VAR (backend_modify, void (*backend_modify)(EV_P_ int fd, int oev, int nev))
 VAR (backend_poll  , void (*backend_poll)(EV_P_ ev_tstamp timeout))
 
+#if !EV_FD_SPARSE || EV_GENWRAP
 VARx(ANFD *, anfds)
+#endif
 VARx(int, anfdmax)
+#if (EV_FD_SPLIT && !EV_FD_SPARSE) || EV_GENWRAP
+VARx(ANFDCOLD *, anfdcold)
+#endif
+#if EV_FD_SPARSE || EV_GENWRAP
+VARx(ANFDPAGE **, anfdpages)
+#endif
 
 VAR (evpipe, int evpipe [2])
 VARx(ev_io, pipe_w)
@@ -105,6 +136,11 @@ VARx(int, epoll_eventmax)
 VARx(int *, epoll_eperms)
 VARx(int, epoll_epermcnt)
 VARx(int, epoll_epermmax)
+VARx(struct epoll_change *, epoll_changes) /* journal for EVFLAG_EPOLL_BATCH */
+VARx(int, epoll_changemax)
+VARx(int, epoll_changecnt)
+VARx(unsigned char, epoll_batch) /* 0 = off, 1 = journal, 2 = journal submitted via io_uring */
+VARx(unsigned char, epoll_nswait) /* epoll_pwait2 usable, waits with nanosecond timeouts */
 #endif
 
 #if EV_USE_LINUXAIO || EV_GENWRAP
@@ -142,9 +178,26 @@ VARx(uint32_t, iouring_cq_ring_mask)
 VARx(uint32_t, iouring_cq_ring_entries)
 VARx(uint32_t, iouring_cq_overflow)
 VARx(uint32_t, iouring_cq_cqes)
-VARx(ev_tstamp, iouring_tfd_to)
-VARx(int, iouring_tfd)
+VARx(uint32_t, iouring_features)
+VARx(unsigned int, iouring_flags)
+VARx(unsigned char, iouring_sqpoll) /* true if a kernel thread submits for us */
+VARx(unsigned char, iouring_multishot) /* IORING_POLL_ADD_MULTI if supported, 0 otherwise */
+VARx(ev_tstamp, iouring_tfd_to) /* expiry of the timerfd or IORING_OP_TIMEOUT */
+VARx(int, iouring_tfd) /* timerfd, or -1 if not needed */
 VARx(ev_io, iouring_tfd_w)
+VARx(struct iouring_kernel_timespec, iouring_timeout_ts)
+VARx(ANURING *, iouring_ops) /* slots for completion-based operations */
+VARx(int, iouring_opmax)
+VARx(int, iouring_opcnt)
+VARx(int, iouring_opfree) /* first free slot, or -1 */
+VARx(unsigned char *, iouring_files) /* 1 for every registered fd, 2 while waiting to unregister it */
+VARx(unsigned int, iouring_filemax) /* size of the registered file table, 0 if none */
+VARx(int *, iouring_filedrops) /* fds to unregister once the sqpoll thread is done with them */
+VARx(int, iouring_filedropmax)
+VARx(int, iouring_filedropcnt)
+VARx(unsigned int, iouring_filedrop_tail) /* sq tail the sqpoll thread has to pass first */
+VARx(void *, iouring_bufring) /* provided buffer ring, or 0 */
+VARx(unsigned short, iouring_buftail)
 #endif
 
 #if EV_USE_KQUEUE || EV_GENWRAP
@@ -173,6 +226,16 @@ VARx(ANHE *, timers)
 VARx(int, timermax)
 VARx(int, timercnt)
 
+#if EV_USE_TIMERWHEEL || EV_GENWRAP
+VARx(int *, twheads) /* first node per wheel slot, or 0 if timers use the heap */
+VAR (twbits, uint64_t twbits [TW_LEVELS * TW_SLOTS / 64]) /* which slots are in use */
+VARx(uint64_t, twtick) /* the current tick, all earlier slots are empty */
+VARx(ANTW *, twnodes)
+VARx(int, twnodemax)
+VARx(int, twnodecnt)
+VARx(int, twfree) /* first free node, or -1 */
+#endif
+
 #if EV_PERIODIC_ENABLE || EV_GENWRAP
 VARx(ANHE *, periodics)
 VARx(int, periodicmax)
@@ -208,11 +271,34 @@ VARx(int, cleanupcnt)
 
 #if EV_ASYNC_ENABLE || EV_GENWRAP
 VARx(EV_ATOMIC_T, async_pending)
+VARx(struct ev_async *, async_sent) /* stack of sent watchers, linked via sent_next */
 VARx(struct ev_async **, asyncs)
 VARx(int, asyncmax)
 VARx(int, asynccnt)
 #endif
 
+#if EV_CHANNEL_ENABLE || EV_GENWRAP
+VARx(EV_ATOMIC_T, channel_pending)
+VARx(struct ev_channel *, channel_sent) /* stack of channels with new messages, linked via sent_next */
+VARx(struct ev_channel **, channels)
+VARx(int, channelmax)
+VARx(int, channelcnt)
+#endif
+
+#if EV_WORK_ENABLE || EV_GENWRAP
+VARx(EV_ATOMIC_T, work_pending)
+VARx(struct ev_work *, work_done) /* stack of watchers whose work function has run, linked via done_next */
+#endif
+
+#if EV_URING_ENABLE || EV_GENWRAP
+VARx(char *, uring_bufs) /* provided buffer pool, see ev_uring_buffers */
+VARx(unsigned int, uring_bufsize)
+VARx(unsigned int, uring_bufcnt)
+VARx(unsigned char *, uring_bufout) /* 1 for every buffer handed out to the user */
+VARx(unsigned short *, uring_buffree) /* free buffers, unless the kernel owns them */
+VARx(unsigned int, uring_buffreecnt)
+#endif
+
 #if EV_USE_INOTIFY || EV_GENWRAP
 VARx(int, fs_fd)
 VARx(ev_io, fs_w)
@@ -221,6 +307,7 @@ VAR (fs_hash, ANFS fs_hash [EV_INOTIFY_HASHSIZE])
 #endif
 
 VARx(EV_ATOMIC_T, sig_pending)
+VAR (sig_bits, unsigned int sig_bits [(EV_NSIG + 30) / 32]) /* signals fed to this loop since pipecb last ran */
 #if EV_USE_SIGNALFD || EV_GENWRAP
 VARx(int, sigfd)
 VARx(ev_io, sigfd_w)
@@ -237,6 +324,7 @@ VARx(unsigned int, origflags) /* original loop flags */
 #if EV_FEATURE_API || EV_GENWRAP
 VARx(unsigned int, loop_count) /* total number of loop iterations/blocks */
 VARx(unsigned int, loop_depth) /* #ev_run enters - #ev_run leaves */
+VARx(unsigned int, slack_saved) /* timer expiries that shared a wakeup thanks to their slack */
 
 VARx(void *, userdata)
 /* C++ doesn't support the ev_loop_callback typedef here. stinks. */
@@ -245,5 +333,10 @@ VAR (acquire_cb, void (*acquire_cb)(EV_P) EV_NOEXCEPT)
 VAR (invoke_cb , ev_loop_callback invoke_cb)
 #endif
 
+#if EV_STATS_ENABLE || EV_GENWRAP
+VARx(ANSTATS *, loop_stats) /* 0 unless ev_set_stats enabled statistics */
+VARx(ANPROFILE *, cb_profile) /* 0 unless ev_set_cb_profile enabled callback profiling */
+#endif
+
 #undef VARx
 
@@ -0,0 +1,400 @@
+/*
+ * libev work pool, runs ev_work functions in other threads
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without modifica-
+ * tion, are permitted provided that the following conditions are met:
+ *
+ *   1.  Redistributions of source code must retain the above copyright notice,
+ *       this list of conditions and the following disclaimer.
+ *
+ *   2.  Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MER-
+ * CHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPE-
+ * CIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTH-
+ * ERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED
+ * OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * Alternatively, the contents of this file may be used under the terms of
+ * the GNU General Public License ("GPL") version 2 or any later version,
+ * in which case the provisions of the GPL are applicable instead of
+ * the above. If you wish to allow the use of your version of this file
+ * only under the terms of the GPL and not to allow others to use your
+ * version of this file under the BSD license, indicate your decision
+ * by deleting the provisions above and replace them with the notice
+ * and other provisions required by the GPL. If you do not delete the
+ * provisions above, a recipient may use your version of this file under
+ * either the BSD or the GPL.
+ */
+
+/*
+ * the work pool is shared by all loops and started on the first
+ * ev_work_start. every worker thread owns a deque, ev_work_start appends
+ * to the deques in turn, a worker takes work from the front of its own
+ * deque and, when that is empty, steals from the back of the others.
+ * since the deques are filled by the loop threads and not by their
+ * owners, a lock-free deque would buy little, so each has a mutex, which
+ * is mostly uncontended, as every worker has its own.
+ *
+ * when a work function has run, the watcher is pushed onto the work_done
+ * stack of its loop, which is then woken up through the signal/async
+ * pipe, just like for ev_async_send.
+ */
+
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+
+#define WORK_IDLE    0
+#define WORK_QUEUED  1 /* in a deque */
+#define WORK_RUNNING 2 /* taken by a worker */
+#define WORK_DONE    3 /* on the work_done stack of its loop */
+
+typedef struct
+{
+  pthread_mutex_t lock;
+  ev_work **q;             /* ring buffer of max entries */
+  unsigned int max, head, cnt;
+  unsigned long executed;  /* the counters are protected by lock, too */
+  unsigned long stolen;
+  pthread_t thread;
+} ANWORKER;
+
+static ANWORKER *workers;
+static unsigned int workercnt;
+static unsigned int workerwant;    /* ev_work_pool_size */
+static EV_ATOMIC_T work_started;
+
+static pthread_mutex_t work_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work_cond = PTHREAD_COND_INITIALIZER;    /* signalled when work was queued */
+static pthread_cond_t work_stopped = PTHREAD_COND_INITIALIZER; /* broadcast when a running work function returns */
+static int work_queued;  /* number of works in all deques */
+static int work_idle;    /* number of workers waiting for work_cond */
+static int work_waiters; /* number of ev_work_stop calls waiting for work_stopped */
+static int work_rr;      /* next deque for ev_work_start */
+
+static ev_work *
+work_take (ANWORKER *wk, int steal)
+{
+  ev_work *w = 0;
+
+  pthread_mutex_lock (&wk->lock);
+
+  if (wk->cnt)
+    {
+      if (steal)
+        w = wk->q [(wk->head + wk->cnt - 1) % wk->max];
+      else
+        {
+          w = wk->q [wk->head];
+          wk->head = (wk->head + 1) % wk->max;
+          ++wk->executed;
+        }
+
+      --wk->cnt;
+      w->state = WORK_RUNNING;
+      ev_atomic_add_int (&work_queued, -1);
+    }
+
+  pthread_mutex_unlock (&wk->lock);
+
+  return w;
+}
+
+static void
+work_finish (ev_work *w)
+{
+#if EV_MULTIPLICITY
+  struct ev_loop *loop = w->loop;
+#endif
+
+  sent_push ((W *)&work_done, (W)w, offsetof (ev_work, done_next));
+
+  /* from now on, the watcher belongs to the loop again */
+  ev_atomic_xchg_int (&w->state, WORK_DONE);
+
+  if (*(volatile int *)&work_waiters)
+    {
+      pthread_mutex_lock (&work_lock);
+      pthread_cond_broadcast (&work_stopped);
+      pthread_mutex_unlock (&work_lock);
+    }
+
+  evpipe_write (EV_A_ &work_pending);
+}
+
+static void *
+work_thread (void *arg)
+{
+  ANWORKER *self = (ANWORKER *)arg;
+  unsigned int idx = self - workers;
+
+  for (;;)
+    {
+      ev_work *w = work_take (self, 0);
+
+      if (!w)
+        {
+          unsigned int i;
+
+          for (i = 1; i < workercnt && !w; ++i)
+            w = work_take (workers + (idx + i) % workercnt, 1);
+
+          /* we hold the lock of the victim only, so count it separately */
+          if (w)
+            {
+              pthread_mutex_lock (&self->lock);
+              ++self->executed;
+              ++self->stolen;
+              pthread_mutex_unlock (&self->lock);
+            }
+        }
+
+      if (w)
+        {
+          w->work (w);
+          work_finish (w);
+          continue;
+        }
+
+      pthread_mutex_lock (&work_lock);
+      ev_atomic_add_int (&work_idle, 1);
+
+      while (!*(volatile int *)&work_queued)
+        pthread_cond_wait (&work_cond, &work_lock);
+
+      ev_atomic_add_int (&work_idle, -1);
+      pthread_mutex_unlock (&work_lock);
+    }
+
+  return 0;
+}
+
+ecb_noinline ecb_cold
+static void
+work_pool_start (void)
+{
+  pthread_mutex_lock (&work_lock);
+
+  if (!work_started)
+    {
+      sigset_t fullset, prevset;
+      unsigned int i, n = workerwant;
+
+#ifdef _SC_NPROCESSORS_ONLN
+      if (!n)
+        n = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+
+      if ((int)n <= 0)
+        n = 1;
+
+      workers = (ANWORKER *)ev_malloc (sizeof (ANWORKER) * n);
+      memset (workers, 0, sizeof (ANWORKER) * n);
+
+      for (i = 0; i < n; ++i)
+        pthread_mutex_init (&workers [i].lock, 0);
+
+      /* the workers must not receive process-directed signals */
+      sigfillset (&fullset);
+      pthread_sigmask (SIG_SETMASK, &fullset, &prevset);
+
+      for (i = 0; i < n; ++i)
+        if (pthread_create (&workers [i].thread, 0, work_thread, (void *)(workers + i)))
+          break;
+
+      pthread_sigmask (SIG_SETMASK, &prevset, 0);
+
+      if (!i)
+        ev_syserr ("(libev) cannot create work pool threads");
+
+      /* workers only ever look at the first workercnt deques */
+      workercnt = i;
+
+      ECB_MEMORY_FENCE_RELEASE;
+      work_started = 1;
+    }
+
+  pthread_mutex_unlock (&work_lock);
+}
+
+/* called by pipecb: feed all watchers whose work function has run, in that order */
+static void
+work_reap (EV_P)
+{
+  ev_work *w, *next;
+  ev_work *done = 0;
+
+  for (w = (ev_work *)ev_atomic_xchg_ptr (&work_done, 0); w; w = next)
+    {
+      next = w->done_next;
+      w->done_next = done;
+      done = w;
+    }
+
+  for (w = done; w; w = next)
+    {
+      /* the worker marks the watcher done right after pushing it, */
+      /* and must be done with it before the callback can restart it */
+      while (ecb_expect_false (*(volatile EV_ATOMIC_T *)&w->state != WORK_DONE))
+        sched_yield ();
+
+      next = w->done_next;
+      w->state = WORK_IDLE;
+      ev_stop (EV_A_ (W)w);
+      ev_feed_event (EV_A_ (W)w, EV_WORK);
+    }
+}
+
+void
+ev_work_start (EV_P_ ev_work *w) EV_NOEXCEPT
+{
+  ANWORKER *wk;
+
+  if (ecb_expect_false (ev_is_active (w)))
+    return;
+
+  if (ecb_expect_false (!work_started))
+    work_pool_start ();
+
+  ECB_MEMORY_FENCE_ACQUIRE;
+
+  evpipe_init (EV_A);
+
+  EV_FREQUENT_CHECK;
+
+#if EV_MULTIPLICITY
+  w->loop = EV_A;
+#endif
+  w->worker = (unsigned int)ev_atomic_add_int (&work_rr, 1) % workercnt;
+  ev_start (EV_A_ (W)w, 1);
+
+  wk = workers + w->worker;
+  pthread_mutex_lock (&wk->lock);
+
+  if (ecb_expect_false (wk->cnt == wk->max))
+    {
+      ev_work **q = (ev_work **)ev_malloc (sizeof (ev_work *) * (wk->max * 2 + 16));
+      unsigned int i;
+
+      for (i = 0; i < wk->cnt; ++i)
+        q [i] = wk->q [(wk->head + i) % wk->max];
+
+      ev_free (wk->q);
+      wk->q    = q;
+      wk->max  = wk->max * 2 + 16;
+      wk->head = 0;
+    }
+
+  wk->q [(wk->head + wk->cnt++) % wk->max] = w;
+  w->state = WORK_QUEUED;
+
+  pthread_mutex_unlock (&wk->lock);
+
+  ev_atomic_add_int (&work_queued, 1);
+
+  if (*(volatile int *)&work_idle)
+    {
+      pthread_mutex_lock (&work_lock);
+      pthread_cond_signal (&work_cond);
+      pthread_mutex_unlock (&work_lock);
+    }
+
+  EV_FREQUENT_CHECK;
+}
+
+void
+ev_work_stop (EV_P_ ev_work *w) EV_NOEXCEPT
+{
+  ANWORKER *wk;
+
+  clear_pending (EV_A_ (W)w);
+  if (ecb_expect_false (!ev_is_active (w)))
+    return;
+
+  EV_FREQUENT_CHECK;
+
+  wk = workers + w->worker;
+  pthread_mutex_lock (&wk->lock);
+
+  if (w->state == WORK_QUEUED)
+    {
+      unsigned int i;
+
+      for (i = 0; wk->q [(wk->head + i) % wk->max] != w; ++i)
+        ;
+
+      for (; i < wk->cnt - 1; ++i)
+        wk->q [(wk->head + i) % wk->max] = wk->q [(wk->head + i + 1) % wk->max];
+
+      --wk->cnt;
+      w->state = WORK_IDLE;
+      ev_atomic_add_int (&work_queued, -1);
+    }
+
+  pthread_mutex_unlock (&wk->lock);
+
+  if (w->state == WORK_RUNNING)
+    {
+      pthread_mutex_lock (&work_lock);
+      ev_atomic_add_int (&work_waiters, 1);
+
+      while (*(volatile EV_ATOMIC_T *)&w->state == WORK_RUNNING)
+        pthread_cond_wait (&work_stopped, &work_lock);
+
+      ev_atomic_add_int (&work_waiters, -1);
+      pthread_mutex_unlock (&work_lock);
+    }
+
+  if (w->state == WORK_DONE)
+    {
+      sent_remove ((W *)&work_done, (W)w, offsetof (ev_work, done_next));
+      w->state = WORK_IDLE;
+    }
+
+  ev_stop (EV_A_ (W)w);
+
+  EV_FREQUENT_CHECK;
+}
+
+void
+ev_work_pool_size (unsigned int threads) EV_NOEXCEPT
+{
+  workerwant = threads;
+}
+
+unsigned int
+ev_work_pool_threads (void) EV_NOEXCEPT
+{
+  return work_started ? workercnt : 0;
+}
+
+int
+ev_work_pool_stats (unsigned int worker, ev_work_stats *stats) EV_NOEXCEPT
+{
+  ANWORKER *wk;
+
+  if (!work_started || worker >= workercnt)
+    return 0;
+
+  wk = workers + worker;
+
+  pthread_mutex_lock (&wk->lock);
+  stats->executed = wk->executed;
+  stats->stolen   = wk->stolen;
+  stats->queued   = wk->cnt;
+  pthread_mutex_unlock (&wk->lock);
+
+  return 1;
+}
+
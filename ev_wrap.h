@@ -3,9 +3,12 @@
 #define EV_WRAP_H
 #define acquire_cb ((loop)->acquire_cb)
 #define activecnt ((loop)->activecnt)
+#define anfdcold ((loop)->anfdcold)
 #define anfdmax ((loop)->anfdmax)
+#define anfdpages ((loop)->anfdpages)
 #define anfds ((loop)->anfds)
 #define async_pending ((loop)->async_pending)
+#define async_sent ((loop)->async_sent)
 #define asynccnt ((loop)->asynccnt)
 #define asyncmax ((loop)->asyncmax)
 #define asyncs ((loop)->asyncs)
@@ -14,18 +17,39 @@
 #define backend_mintime ((loop)->backend_mintime)
 #define backend_modify ((loop)->backend_modify)
 #define backend_poll ((loop)->backend_poll)
+#define busypoll_budget ((loop)->busypoll_budget)
+#define busypoll_gap ((loop)->busypoll_gap)
+#define busypoll_hits ((loop)->busypoll_hits)
+#define busypoll_last ((loop)->busypoll_last)
+#define busypoll_spins ((loop)->busypoll_spins)
+#define busypoll_window ((loop)->busypoll_window)
+#define cb_profile ((loop)->cb_profile)
+#define channel_pending ((loop)->channel_pending)
+#define channel_sent ((loop)->channel_sent)
+#define channelcnt ((loop)->channelcnt)
+#define channelmax ((loop)->channelmax)
+#define channels ((loop)->channels)
 #define checkcnt ((loop)->checkcnt)
 #define checkmax ((loop)->checkmax)
 #define checks ((loop)->checks)
 #define cleanupcnt ((loop)->cleanupcnt)
 #define cleanupmax ((loop)->cleanupmax)
 #define cleanups ((loop)->cleanups)
+#define clock_maxdrift ((loop)->clock_maxdrift)
+#define clock_policy ((loop)->clock_policy)
+#define clock_res ((loop)->clock_res)
+#define clock_resynccnt ((loop)->clock_resynccnt)
 #define curpid ((loop)->curpid)
+#define epoll_batch ((loop)->epoll_batch)
+#define epoll_changecnt ((loop)->epoll_changecnt)
+#define epoll_changemax ((loop)->epoll_changemax)
+#define epoll_changes ((loop)->epoll_changes)
 #define epoll_epermcnt ((loop)->epoll_epermcnt)
 #define epoll_epermmax ((loop)->epoll_epermmax)
 #define epoll_eperms ((loop)->epoll_eperms)
 #define epoll_eventmax ((loop)->epoll_eventmax)
 #define epoll_events ((loop)->epoll_events)
+#define epoll_nswait ((loop)->epoll_nswait)
 #define evpipe ((loop)->evpipe)
 #define fdchangecnt ((loop)->fdchangecnt)
 #define fdchangemax ((loop)->fdchangemax)
@@ -44,6 +68,8 @@
 #define invoke_cb ((loop)->invoke_cb)
 #define io_blocktime ((loop)->io_blocktime)
 #define iocp ((loop)->iocp)
+#define iouring_bufring ((loop)->iouring_bufring)
+#define iouring_buftail ((loop)->iouring_buftail)
 #define iouring_cq_cqes ((loop)->iouring_cq_cqes)
 #define iouring_cq_head ((loop)->iouring_cq_head)
 #define iouring_cq_overflow ((loop)->iouring_cq_overflow)
@@ -54,7 +80,20 @@
 #define iouring_cq_tail ((loop)->iouring_cq_tail)
 #define iouring_entries ((loop)->iouring_entries)
 #define iouring_fd ((loop)->iouring_fd)
+#define iouring_features ((loop)->iouring_features)
+#define iouring_filedrop_tail ((loop)->iouring_filedrop_tail)
+#define iouring_filedropcnt ((loop)->iouring_filedropcnt)
+#define iouring_filedropmax ((loop)->iouring_filedropmax)
+#define iouring_filedrops ((loop)->iouring_filedrops)
+#define iouring_filemax ((loop)->iouring_filemax)
+#define iouring_files ((loop)->iouring_files)
+#define iouring_flags ((loop)->iouring_flags)
 #define iouring_max_entries ((loop)->iouring_max_entries)
+#define iouring_multishot ((loop)->iouring_multishot)
+#define iouring_opcnt ((loop)->iouring_opcnt)
+#define iouring_opfree ((loop)->iouring_opfree)
+#define iouring_opmax ((loop)->iouring_opmax)
+#define iouring_ops ((loop)->iouring_ops)
 #define iouring_sq_array ((loop)->iouring_sq_array)
 #define iouring_sq_dropped ((loop)->iouring_sq_dropped)
 #define iouring_sq_flags ((loop)->iouring_sq_flags)
@@ -66,9 +105,11 @@
 #define iouring_sq_tail ((loop)->iouring_sq_tail)
 #define iouring_sqes ((loop)->iouring_sqes)
 #define iouring_sqes_size ((loop)->iouring_sqes_size)
+#define iouring_sqpoll ((loop)->iouring_sqpoll)
 #define iouring_tfd ((loop)->iouring_tfd)
 #define iouring_tfd_to ((loop)->iouring_tfd_to)
 #define iouring_tfd_w ((loop)->iouring_tfd_w)
+#define iouring_timeout_ts ((loop)->iouring_timeout_ts)
 #define iouring_to_submit ((loop)->iouring_to_submit)
 #define kqueue_changecnt ((loop)->kqueue_changecnt)
 #define kqueue_changemax ((loop)->kqueue_changemax)
@@ -87,6 +128,7 @@
 #define loop_count ((loop)->loop_count)
 #define loop_depth ((loop)->loop_depth)
 #define loop_done ((loop)->loop_done)
+#define loop_stats ((loop)->loop_stats)
 #define mn_now ((loop)->mn_now)
 #define now_floor ((loop)->now_floor)
 #define origflags ((loop)->origflags)
@@ -117,16 +159,36 @@
 #define rfeedmax ((loop)->rfeedmax)
 #define rfeeds ((loop)->rfeeds)
 #define rtmn_diff ((loop)->rtmn_diff)
+#define sig_bits ((loop)->sig_bits)
 #define sig_pending ((loop)->sig_pending)
 #define sigfd ((loop)->sigfd)
 #define sigfd_set ((loop)->sigfd_set)
 #define sigfd_w ((loop)->sigfd_w)
+#define slack_saved ((loop)->slack_saved)
 #define timeout_blocktime ((loop)->timeout_blocktime)
 #define timercnt ((loop)->timercnt)
 #define timerfd ((loop)->timerfd)
 #define timerfd_w ((loop)->timerfd_w)
 #define timermax ((loop)->timermax)
 #define timers ((loop)->timers)
+#define tsc_base ((loop)->tsc_base)
+#define tsc_cal ((loop)->tsc_cal)
+#define tsc_calmono ((loop)->tsc_calmono)
+#define tsc_mono ((loop)->tsc_mono)
+#define tsc_scale ((loop)->tsc_scale)
+#define twbits ((loop)->twbits)
+#define twfree ((loop)->twfree)
+#define twheads ((loop)->twheads)
+#define twnodecnt ((loop)->twnodecnt)
+#define twnodemax ((loop)->twnodemax)
+#define twnodes ((loop)->twnodes)
+#define twtick ((loop)->twtick)
+#define uring_bufcnt ((loop)->uring_bufcnt)
+#define uring_buffree ((loop)->uring_buffree)
+#define uring_buffreecnt ((loop)->uring_buffreecnt)
+#define uring_bufout ((loop)->uring_bufout)
+#define uring_bufs ((loop)->uring_bufs)
+#define uring_bufsize ((loop)->uring_bufsize)
 #define userdata ((loop)->userdata)
 #define vec_eo ((loop)->vec_eo)
 #define vec_max ((loop)->vec_max)
@@ -134,13 +196,18 @@
 #define vec_ro ((loop)->vec_ro)
 #define vec_wi ((loop)->vec_wi)
 #define vec_wo ((loop)->vec_wo)
+#define work_done ((loop)->work_done)
+#define work_pending ((loop)->work_pending)
 #else
 #undef EV_WRAP_H
 #undef acquire_cb
 #undef activecnt
+#undef anfdcold
 #undef anfdmax
+#undef anfdpages
 #undef anfds
 #undef async_pending
+#undef async_sent
 #undef asynccnt
 #undef asyncmax
 #undef asyncs
@@ -149,18 +216,39 @@
 #undef backend_mintime
 #undef backend_modify
 #undef backend_poll
+#undef busypoll_budget
+#undef busypoll_gap
+#undef busypoll_hits
+#undef busypoll_last
+#undef busypoll_spins
+#undef busypoll_window
+#undef cb_profile
+#undef channel_pending
+#undef channel_sent
+#undef channelcnt
+#undef channelmax
+#undef channels
 #undef checkcnt
 #undef checkmax
 #undef checks
 #undef cleanupcnt
 #undef cleanupmax
 #undef cleanups
+#undef clock_maxdrift
+#undef clock_policy
+#undef clock_res
+#undef clock_resynccnt
 #undef curpid
+#undef epoll_batch
+#undef epoll_changecnt
+#undef epoll_changemax
+#undef epoll_changes
 #undef epoll_epermcnt
 #undef epoll_epermmax
 #undef epoll_eperms
 #undef epoll_eventmax
 #undef epoll_events
+#undef epoll_nswait
 #undef evpipe
 #undef fdchangecnt
 #undef fdchangemax
@@ -179,6 +267,8 @@
 #undef invoke_cb
 #undef io_blocktime
 #undef iocp
+#undef iouring_bufring
+#undef iouring_buftail
 #undef iouring_cq_cqes
 #undef iouring_cq_head
 #undef iouring_cq_overflow
@@ -189,7 +279,20 @@
 #undef iouring_cq_tail
 #undef iouring_entries
 #undef iouring_fd
+#undef iouring_features
+#undef iouring_filedrop_tail
+#undef iouring_filedropcnt
+#undef iouring_filedropmax
+#undef iouring_filedrops
+#undef iouring_filemax
+#undef iouring_files
+#undef iouring_flags
 #undef iouring_max_entries
+#undef iouring_multishot
+#undef iouring_opcnt
+#undef iouring_opfree
+#undef iouring_opmax
+#undef iouring_ops
 #undef iouring_sq_array
 #undef iouring_sq_dropped
 #undef iouring_sq_flags
@@ -201,9 +304,11 @@
 #undef iouring_sq_tail
 #undef iouring_sqes
 #undef iouring_sqes_size
+#undef iouring_sqpoll
 #undef iouring_tfd
 #undef iouring_tfd_to
 #undef iouring_tfd_w
+#undef iouring_timeout_ts
 #undef iouring_to_submit
 #undef kqueue_changecnt
 #undef kqueue_changemax
@@ -222,6 +327,7 @@
 #undef loop_count
 #undef loop_depth
 #undef loop_done
+#undef loop_stats
 #undef mn_now
 #undef now_floor
 #undef origflags
@@ -252,16 +358,36 @@
 #undef rfeedmax
 #undef rfeeds
 #undef rtmn_diff
+#undef sig_bits
 #undef sig_pending
 #undef sigfd
 #undef sigfd_set
 #undef sigfd_w
+#undef slack_saved
 #undef timeout_blocktime
 #undef timercnt
 #undef timerfd
 #undef timerfd_w
 #undef timermax
 #undef timers
+#undef tsc_base
+#undef tsc_cal
+#undef tsc_calmono
+#undef tsc_mono
+#undef tsc_scale
+#undef twbits
+#undef twfree
+#undef twheads
+#undef twnodecnt
+#undef twnodemax
+#undef twnodes
+#undef twtick
+#undef uring_bufcnt
+#undef uring_buffree
+#undef uring_buffreecnt
+#undef uring_bufout
+#undef uring_bufs
+#undef uring_bufsize
 #undef userdata
 #undef vec_eo
 #undef vec_max
@@ -269,4 +395,6 @@
 #undef vec_ro
 #undef vec_wi
 #undef vec_wo
+#undef work_done
+#undef work_pending
 #endif
@@ -68,11 +68,11 @@ ev_tv_get (struct timeval *tv)
 {
   if (tv)
     {
-      ev_tstamp after = tv->tv_sec + tv->tv_usec * 1e-6;
-      return after ? after : 1e-6;
+      ev_tstamp after = EV_TS_FROM_SEC (tv->tv_sec + tv->tv_usec * 1e-6);
+      return after ? after : EV_TS_FROM_SEC (1e-6);
     }
   else
-    return -1.;
+    return EV_TS_FROM_SEC (-1.);
 }
 
 #define EVENT_STRINGIFY(s) # s
@@ -324,10 +324,10 @@ int event_pending (struct event *ev, short events, struct timeval *tv)
 
       if (tv)
         {
-          ev_tstamp at = ev_now (EV_A);
+          double at = EV_TS_TO_SEC (ev_now (EV_A));
 
           tv->tv_sec  = (long)at;
-          tv->tv_usec = (long)((at - (ev_tstamp)tv->tv_sec) * 1e6);
+          tv->tv_usec = (long)((at - (double)tv->tv_sec) * 1e6);
         }
     }
 
@@ -3,7 +3,7 @@ dnl http://software.schmorp.de/pkg/libev
 
 dnl libev support
 AC_CHECK_HEADERS(sys/inotify.h sys/epoll.h sys/event.h port.h poll.h sys/timerfd.h)
-AC_CHECK_HEADERS(sys/select.h sys/eventfd.h sys/signalfd.h linux/aio_abi.h linux/fs.h)
+AC_CHECK_HEADERS(sys/select.h sys/eventfd.h sys/signalfd.h linux/aio_abi.h linux/fs.h sys/sdt.h)
  
 AC_CHECK_FUNCS(inotify_init epoll_ctl kqueue port_create poll select eventfd signalfd)
  
@@ -45,3 +45,6 @@ if test -z "$LIBEV_M4_AVOID_LIBM"; then
 fi
 AC_SEARCH_LIBS(floor, $LIBM, [AC_DEFINE(HAVE_FLOOR, 1, Define to 1 if the floor function is available)])
 
+if test -z "$LIBEV_M4_AVOID_PTHREAD"; then
+   AC_SEARCH_LIBS(pthread_create, pthread)
+fi